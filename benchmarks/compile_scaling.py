@@ -0,0 +1,132 @@
+"""Measure how hw5's compile time, memory and output size scale along each dimension of a synthetic program.
+
+Usage: python3 benchmarks/compile_scaling.py [--hw5 ./hw5] [--runs 3] [--points 5] [--json results.json] [axis ...]
+Axes default to all of them (see fanc_generator.Shape). Each axis is doubled from its start value while the others
+stay at their defaults, and each point is compiled with --stats=json. The exponent is the slope of compile time
+against the axis on a log-log scale: about 1 is linear, and anything well above it is flagged, as it means some part
+of the compiler (the code buffer, the symbol table, the grammar) doesn't scale with that dimension of the program.
+"""
+import argparse
+import json
+import math
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from fanc_generator import Shape, generate  # noqa: E402
+
+# First value of each axis. Large enough for the compile time to dominate the fixed cost of a compilation
+AXES = {
+    'functions': 500,
+    'depth': 100,
+    'nesting': 50,
+    'chain': 50,
+    'strings': 20,
+    'params': 20,
+}
+
+# Exponents above this are reported as non-linear
+NON_LINEAR = 1.2
+
+
+def compile_once(hw5, source, output):
+    result = subprocess.run([hw5, '--stats=json', '-o', output, source], stderr=subprocess.PIPE, check=True)
+    stats = json.loads(result.stderr.decode().strip().splitlines()[-1])
+    with open(output) as output_file:
+        first_line = output_file.readline()
+    if first_line.startswith('line '):
+        raise RuntimeError(f'{source} does not compile: {first_line.strip()}')
+    return stats
+
+
+def measure(hw5, directory, shape, runs):
+    source = os.path.join(directory, 'program.fanc')
+    output = os.path.join(directory, 'program.ll')
+    with open(source, 'w') as source_file:
+        source_file.write(generate(shape))
+
+    all_stats = [compile_once(hw5, source, output) for _ in range(runs)]
+    return {
+        'sourceBytes': os.path.getsize(source),
+        'outputBytes': os.path.getsize(output),
+        # The median is steadier than the minimum when a run is slowed by something else on the machine
+        'ms': statistics.median(stats['totalMs'] for stats in all_stats),
+        'phaseMs': {phase: statistics.median(stats['phases'][phase]['ms'] for stats in all_stats)
+                    for phase in all_stats[0]['phases']},
+        'peakRssKb': max(stats['peakRssKb'] for stats in all_stats),
+    }
+
+
+def exponent(xs, ys):
+    # Least squares slope of log(y) against log(x)
+    log_xs = [math.log(x) for x in xs]
+    log_ys = [math.log(max(y, 1e-9)) for y in ys]
+    mean_x = statistics.mean(log_xs)
+    mean_y = statistics.mean(log_ys)
+    spread = sum((x - mean_x) ** 2 for x in log_xs)
+    return sum((x - mean_x) * (y - mean_y) for x, y in zip(log_xs, log_ys)) / spread
+
+
+def sweep(hw5, directory, axis, points, runs):
+    results = []
+    for i in range(points):
+        value = AXES[axis] * 2 ** i
+        shape = Shape(**{axis: value})
+        results.append(dict(value=value, **measure(hw5, directory, shape, runs)))
+    return results
+
+
+def report(axis, results):
+    values = [result['value'] for result in results]
+    fits = {
+        'ms': exponent(values, [result['ms'] for result in results]),
+        'peakRssKb': exponent(values, [result['peakRssKb'] for result in results]),
+        'outputBytes': exponent(values, [result['outputBytes'] for result in results]),
+    }
+    print(f'{axis}:')
+    print(f'    {"value":>8} {"ms":>10} {"parse ms":>10} {"emit ms":>10} {"peak RSS KB":>12} {"output bytes":>14}')
+    for result in results:
+        print(f'    {result["value"]:>8} {result["ms"]:>10.2f} {result["phaseMs"]["parse"]:>10.2f} '
+              f'{result["phaseMs"]["emit"]:>10.2f} {result["peakRssKb"]:>12} {result["outputBytes"]:>14}')
+    verdict = 'NON-LINEAR' if fits['ms'] > NON_LINEAR else 'linear'
+    print(f'    exponent: time {fits["ms"]:.2f} ({verdict}), memory {fits["peakRssKb"]:.2f}, '
+          f'output {fits["outputBytes"]:.2f}')
+    return fits
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--hw5', default='./hw5')
+    parser.add_argument('--runs', type=int, default=3)
+    parser.add_argument('--points', type=int, default=5)
+    parser.add_argument('--json', help='also write the measurements to this file, to compare across versions')
+    parser.add_argument('axes', nargs='*')
+    args = parser.parse_args()
+    for axis in args.axes:
+        if axis not in AXES:
+            parser.error(f'unknown axis {axis}, expected one of {", ".join(AXES)}')
+
+    hw5 = os.path.abspath(args.hw5)
+    summary = {}
+    non_linear = []
+    with tempfile.TemporaryDirectory() as directory:
+        for axis in args.axes or list(AXES):
+            results = sweep(hw5, directory, axis, args.points, args.runs)
+            fits = report(axis, results)
+            summary[axis] = {'points': results, 'exponents': fits}
+            if fits['ms'] > NON_LINEAR:
+                non_linear.append(axis)
+
+    if args.json:
+        with open(args.json, 'w') as json_file:
+            json.dump(summary, json_file, indent=2)
+    if non_linear:
+        print(f'compile time grows faster than linearly with: {", ".join(non_linear)}')
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,110 @@
+"""Generate synthetic FanC programs of a given shape, for compile-time benchmarks.
+
+Usage: python3 benchmarks/fanc_generator.py [--functions 50] [--depth 4] [--nesting 2] [--chain 3] [--strings 1]
+                                            [--params 2] [--seed 1] > program.fanc
+Every knob grows one dimension of the program and leaves the others alone, so compile time can be measured along
+each of them separately. The programs are valid FanC, and run to completion quickly whatever their size.
+"""
+import argparse
+import random
+
+
+class Shape:
+    def __init__(self, functions=50, depth=4, nesting=2, chain=3, strings=1, params=2, seed=1):
+        # Number of functions besides main
+        self.functions = functions
+        # Parenthesized nesting depth of the arithmetic expression in each function
+        self.depth = depth
+        # Depth of nested if/while statements in each function
+        self.nesting = nesting
+        # Number of comparisons in the and/or chain in each function
+        self.chain = chain
+        # Number of string literals printed by each function
+        self.strings = strings
+        # Number of int parameters of each function
+        self.params = params
+        self.seed = seed
+
+
+def operand(random_source, params):
+    if params and random_source.random() < 0.6:
+        return f'p{random_source.randrange(params)}'
+    return str(random_source.randrange(1, 100))
+
+
+def arithmetic(random_source, depth, params):
+    # Right-nested, so the parser's stack grows with the depth: a + (b * (c - ...))
+    expression = operand(random_source, params)
+    for _ in range(depth):
+        operator = random_source.choice(['+', '-', '*'])
+        expression = f'({operand(random_source, params)} {operator} {expression})'
+    return expression
+
+
+def bool_chain(random_source, chain, params):
+    comparisons = []
+    for _ in range(chain):
+        comparison = random_source.choice(['==', '!=', '<', '<=', '>', '>='])
+        comparisons.append(f'{operand(random_source, params)} {comparison} {operand(random_source, params)}')
+        comparisons.append(random_source.choice(['and', 'or']))
+    return ' '.join(comparisons[:-1]) or 'true'
+
+
+def nested_statements(random_source, level, nesting, indent):
+    pad = '    ' * indent
+    if level == nesting:
+        return [f'{pad}acc = acc + {level};']
+
+    inner = nested_statements(random_source, level + 1, nesting, indent + 1)
+    if level % 2 == 0:
+        # Runs its body once, so the running time doesn't grow with the nesting
+        return [f'{pad}while (acc < 1000000) {{'] + inner + [f'{pad}    break;', f'{pad}}}']
+    return [f'{pad}if (acc != {level} or acc == {level}) {{'] + inner + [f'{pad}}} else {{', f'{pad}    acc = acc - 1;',
+                                                                       f'{pad}}}']
+
+
+def function(random_source, index, shape):
+    params = ', '.join(f'int p{i}' for i in range(shape.params))
+    lines = [f'int f{index}({params}) {{']
+    lines.append(f'    int acc = {operand(random_source, shape.params)};')
+    # Multiplying by 0 keeps the values small however deep the expression is
+    lines.append(f'    acc = acc + 0 * {arithmetic(random_source, shape.depth, shape.params)};')
+    lines.append(f'    if ({bool_chain(random_source, shape.chain, shape.params)}) {{')
+    lines.append('        acc = acc + 1;')
+    lines.append('    }')
+    lines.extend(nested_statements(random_source, 0, shape.nesting, 1))
+    for i in range(shape.strings):
+        lines.append(f'    print("f{index} string {i}");')
+    lines.append('    return acc;')
+    lines.append('}')
+    return lines
+
+
+def generate(shape):
+    random_source = random.Random(shape.seed)
+    lines = []
+    for index in range(shape.functions):
+        lines.extend(function(random_source, index, shape))
+        lines.append('')
+
+    lines.append('void main() {')
+    lines.append('    int total = 0;')
+    for index in range(shape.functions):
+        args = ', '.join(str(random_source.randrange(1, 10)) for _ in range(shape.params))
+        lines.append(f'    total = total + f{index}({args});')
+    lines.append('    printi(total);')
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    defaults = Shape()
+    for knob in ['functions', 'depth', 'nesting', 'chain', 'strings', 'params', 'seed']:
+        parser.add_argument(f'--{knob}', type=int, default=getattr(defaults, knob))
+    args = parser.parse_args()
+    print(generate(Shape(**vars(args))), end='')
+
+
+if __name__ == '__main__':
+    main()
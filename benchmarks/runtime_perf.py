@@ -0,0 +1,234 @@
+"""Measure how fast the code hw5 generates runs, and flag changes that make it slower than the recorded baseline.
+
+Usage: python3 benchmarks/runtime_perf.py [--hw5 ./hw5] [--runs 3] [--tolerance 0.25] [--update] [program.in ...]
+Programs default to benchmarks/runtime/*.in, each with the output it must print in the matching .out. Every program
+is compiled once and run under lli and as a native binary built with llc. Besides the wall times this records the
+static count of IR instructions, and the dynamic count of IR instructions executed, which is measured by running a
+copy of the IR that counts them per basic block. The dynamic count is exact, so any increase of it over the baseline
+is a regression, while times only are when they grow by more than the tolerance. With a perf that can read hardware
+counters, the instructions the native binary retires are recorded too. --update makes the results the new baseline.
+"""
+import argparse
+import glob
+import json
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+RUNTIME_DIRECTORY = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'runtime')
+BASELINE_PATH = os.path.join(RUNTIME_DIRECTORY, 'baseline.json')
+
+LABEL = re.compile(r'^\s*[\w.$]+:')
+TERMINATORS = ('ret ', 'ret\t', 'br ', 'switch ', 'unreachable')
+DYNAMIC_COUNT = re.compile(rb'^dynamic instructions: (\d+)$', re.MULTILINE)
+
+COUNTER_RUNTIME = '''
+@dynamicInstructions = global i64 0
+@dynamicInstructionsFormat = constant [27 x i8] c"dynamic instructions: %ld\\0A\\00"
+declare i32 @dprintf(i32, i8*, ...)
+define void @reportDynamicInstructions() {
+    %count = load i64, i64* @dynamicInstructions
+    %format = getelementptr [27 x i8], [27 x i8]* @dynamicInstructionsFormat, i32 0, i32 0
+    call i32 (i32, i8*, ...) @dprintf(i32 2, i8* %format, i64 %count)
+    ret void
+}
+@llvm.global_dtors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @reportDynamicInstructions, i8* null }]
+'''
+
+
+def instruction(line):
+    # The instruction on a line of a function body, without hw5's trailing line number comment, or ''
+    code = line.split(';', 1)[0].strip()
+    return '' if LABEL.match(code) else code
+
+
+def static_instructions(ir):
+    count = 0
+    in_function = False
+    for line in ir.splitlines():
+        if line.startswith('define '):
+            in_function = True
+        elif line.startswith('}'):
+            in_function = False
+        elif in_function and instruction(line):
+            count += 1
+    return count
+
+
+def count_block(block, counter):
+    # Add the instructions of block (its lines, the first one being its label if it has one) to the counter, after
+    # its phis, which must stay first
+    position = 1 if block and LABEL.match(block[0].split(';', 1)[0]) else 0
+    while position < len(block) and ' = phi ' in block[position]:
+        position += 1
+    count = sum(1 for line in block if instruction(line))
+    if count == 0:
+        return block
+    loaded = f'%dynamicCount_{counter}'
+    added = f'%dynamicCountAdded_{counter}'
+    return block[:position] + [
+        f'\t{loaded} = load i64, i64* @dynamicInstructions',
+        f'\t{added} = add i64 {loaded}, {count}',
+        f'\tstore i64 {added}, i64* @dynamicInstructions',
+    ] + block[position:]
+
+
+def instrument(ir):
+    # A copy of ir that prints the number of IR instructions it executed to stderr when it exits. Blocks are split at
+    # labels and after terminators, since hw5 leaves unreachable instructions after them
+    lines = []
+    block = None
+    blocks = 0
+    for line in ir.splitlines():
+        if line.startswith('define '):
+            lines.append(line)
+            block = []
+        elif line.startswith('}') and block is not None:
+            lines.extend(count_block(block, blocks))
+            lines.append(line)
+            block = None
+        elif block is None:
+            lines.append(line)
+        elif LABEL.match(line.split(';', 1)[0]):
+            lines.extend(count_block(block, blocks))
+            blocks += 1
+            block = [line]
+        else:
+            block.append(line)
+            if instruction(line).startswith(TERMINATORS):
+                lines.extend(count_block(block, blocks))
+                blocks += 1
+                block = []
+    return '\n'.join(lines) + COUNTER_RUNTIME
+
+
+def timed_runs(command, runs, expected_output):
+    times = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        times.append((time.perf_counter() - start) * 1000)
+        if result.stdout != expected_output:
+            raise RuntimeError(f'{" ".join(command)} printed the wrong output')
+    return round(statistics.median(times), 1)
+
+
+def native_instructions(binary):
+    if not shutil.which('perf'):
+        return None
+    result = subprocess.run(['perf', 'stat', '-x', ',', '-e', 'instructions:u', binary], stdout=subprocess.DEVNULL,
+                            stderr=subprocess.PIPE)
+    for line in result.stderr.decode().splitlines():
+        fields = line.split(',')
+        if len(fields) > 2 and 'instructions' in fields[2] and fields[0].isdigit():
+            return int(fields[0])
+    return None
+
+
+def measure(hw5, directory, source, runs):
+    name = os.path.splitext(os.path.basename(source))[0]
+    with open(os.path.splitext(source)[0] + '.out', 'rb') as expected_file:
+        expected_output = expected_file.read()
+
+    ir_path = os.path.join(directory, f'{name}.ll')
+    subprocess.run([hw5, source, '-o', ir_path], check=True)
+    with open(ir_path) as ir_file:
+        ir = ir_file.read()
+    if ir.startswith('line '):
+        raise RuntimeError(f'{source} does not compile: {ir.splitlines()[0]}')
+
+    counting_path = os.path.join(directory, f'{name}.counting.ll')
+    with open(counting_path, 'w') as counting_file:
+        counting_file.write(instrument(ir))
+    # Not checked, as lli exits with whatever is left in the return register of hw5's void main
+    counted = subprocess.run(['lli', counting_path], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if counted.stdout != expected_output:
+        raise RuntimeError(f'{source} printed the wrong output')
+
+    result = {
+        'staticInstructions': static_instructions(ir),
+        'dynamicInstructions': int(DYNAMIC_COUNT.search(counted.stderr).group(1)),
+        'lliMs': timed_runs(['lli', ir_path], runs, expected_output),
+    }
+
+    if shutil.which('llc') and shutil.which('gcc'):
+        object_path = os.path.join(directory, f'{name}.o')
+        binary = os.path.join(directory, name)
+        subprocess.run(['llc', '-O2', '-filetype=obj', '-relocation-model=pic', ir_path, '-o', object_path], check=True)
+        subprocess.run(['gcc', object_path, '-o', binary], check=True)
+        result['nativeMs'] = timed_runs([binary], runs, expected_output)
+        instructions = native_instructions(binary)
+        if instructions is not None:
+            result['nativeInstructions'] = instructions
+    return name, result
+
+
+def regressions(name, result, baseline, tolerance):
+    found = []
+    recorded = baseline.get(name)
+    if recorded is None:
+        return found
+    for counter in ['dynamicInstructions', 'nativeInstructions']:
+        if counter in result and counter in recorded and result[counter] > recorded[counter]:
+            found.append(f'{name}: {counter} {recorded[counter]} -> {result[counter]}')
+    for timing in ['lliMs', 'nativeMs']:
+        if timing in result and timing in recorded and result[timing] > recorded[timing] * (1 + tolerance):
+            found.append(f'{name}: {timing} {recorded[timing]:.1f} -> {result[timing]:.1f}')
+    return found
+
+
+def change(result, recorded, key):
+    if key not in result or key not in recorded or not recorded[key]:
+        return ''
+    return f'({(result[key] / recorded[key] - 1) * 100:+.1f}%)'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--hw5', default='./hw5')
+    parser.add_argument('--runs', type=int, default=3)
+    parser.add_argument('--tolerance', type=float, default=0.25, help='fraction by which times may grow')
+    parser.add_argument('--update', action='store_true', help='record the results as the new baseline')
+    parser.add_argument('sources', nargs='*')
+    args = parser.parse_args()
+
+    hw5 = os.path.abspath(args.hw5)
+    sources = args.sources or sorted(glob.glob(os.path.join(RUNTIME_DIRECTORY, '*.in')))
+    baseline = {}
+    if os.path.exists(BASELINE_PATH):
+        with open(BASELINE_PATH) as baseline_file:
+            baseline = json.load(baseline_file)
+
+    results = {}
+    found = []
+    print(f'{"program":<14} {"static":>8} {"dynamic":>24} {"lli ms":>18} {"native ms":>18}')
+    with tempfile.TemporaryDirectory() as directory:
+        for source in sources:
+            name, result = measure(hw5, directory, source, args.runs)
+            results[name] = result
+            recorded = baseline.get(name, {})
+            print(f'{name:<14} {result["staticInstructions"]:>8} '
+                  f'{result["dynamicInstructions"]:>12} {change(result, recorded, "dynamicInstructions"):>11} '
+                  f'{result["lliMs"]:>8.1f} {change(result, recorded, "lliMs"):>9} '
+                  f'{result.get("nativeMs", float("nan")):>8.1f} {change(result, recorded, "nativeMs"):>9}')
+            found += regressions(name, result, baseline, args.tolerance)
+
+    if args.update:
+        baseline.update(results)
+        with open(BASELINE_PATH, 'w') as baseline_file:
+            json.dump(baseline, baseline_file, indent=2, sort_keys=True)
+            baseline_file.write('\n')
+    elif found:
+        print('slower than the baseline:')
+        for regression in found:
+            print(f'    {regression}')
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,95 @@
+"""Compare the latency of compiling through a running `hw5 --server` against starting hw5 for every source.
+
+Usage: python3 benchmarks/server_latency.py [--hw5 ./hw5] [--runs 5] [source.in ...]
+Sources default to every test under tests/. Times are wall clock per compile, in milliseconds.
+"""
+import argparse
+import glob
+import os
+import socket
+import statistics
+import subprocess
+import tempfile
+import time
+
+
+def compile_with_process(hw5, source):
+    with open(source, 'rb') as source_file:
+        return subprocess.run([hw5], stdin=source_file, stdout=subprocess.PIPE, check=True).stdout
+
+
+def compile_with_client(hw5, socket_path, source):
+    return subprocess.run([hw5, '--client', socket_path, source], stdout=subprocess.PIPE, check=True).stdout
+
+
+def compile_with_socket(socket_path, text):
+    # What an editor integration would do: talk to the server directly, without starting any process
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as connection:
+        connection.connect(socket_path)
+        connection.sendall(text)
+        connection.shutdown(socket.SHUT_WR)
+        chunks = []
+        while True:
+            chunk = connection.recv(1 << 16)
+            if not chunk:
+                return b''.join(chunks)
+            chunks.append(chunk)
+
+
+def wait_for_socket(socket_path, timeout=5.0):
+    deadline = time.monotonic() + timeout
+    while not os.path.exists(socket_path):
+        if time.monotonic() > deadline:
+            raise RuntimeError(f'server did not create {socket_path}')
+        time.sleep(0.01)
+
+
+def measure(compile_one, sources, runs):
+    times = []
+    for _ in range(runs):
+        for source in sources:
+            start = time.perf_counter()
+            compile_one(source)
+            times.append((time.perf_counter() - start) * 1000)
+    return times
+
+
+def report(name, times):
+    times = sorted(times)
+    p95 = times[min(len(times) - 1, int(len(times) * 0.95))]
+    print(f'{name:<10} median {statistics.median(times):8.3f} ms   p95 {p95:8.3f} ms   total {sum(times):10.1f} ms')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--hw5', default='./hw5')
+    parser.add_argument('--runs', type=int, default=5)
+    parser.add_argument('sources', nargs='*')
+    args = parser.parse_args()
+
+    hw5 = os.path.abspath(args.hw5)
+    sources = args.sources or sorted(glob.glob('tests/**/*.in', recursive=True))
+    texts = {source: open(source, 'rb').read() for source in sources}
+
+    with tempfile.TemporaryDirectory() as directory:
+        socket_path = os.path.join(directory, 'hw5.sock')
+        server = subprocess.Popen([hw5, '--server', socket_path])
+        try:
+            wait_for_socket(socket_path)
+
+            # The server must answer exactly what a fresh process prints
+            for source in sources:
+                if compile_with_socket(socket_path, texts[source]) != compile_with_process(hw5, source):
+                    raise RuntimeError(f'server output differs from hw5 output for {source}')
+
+            print(f'{len(sources)} sources, {args.runs} runs each')
+            report('process', measure(lambda source: compile_with_process(hw5, source), sources, args.runs))
+            report('client', measure(lambda source: compile_with_client(hw5, socket_path, source), sources, args.runs))
+            report('socket', measure(lambda source: compile_with_socket(socket_path, texts[source]), sources, args.runs))
+        finally:
+            server.terminate()
+            server.wait()
+
+
+if __name__ == '__main__':
+    main()
@@ -1,32 +1,64 @@
 #include "bp.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <sstream>
 #include <vector>
 
-#include "ralloc.hpp"
-#include "symbolTable.hpp"
-
-extern int yylineno;
+#include "compilation.hpp"
+#include "debugInfo.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
+#include "tokens.hpp"
+#include "trace.hpp"
 
 using namespace std;
 
 bool replace(string& str, const string& from, const string& to, const BranchLabelIndex index);
 
-CodeBuffer::CodeBuffer() : buffer(), globalDefs() {}
+//inserts the lines from begin up to end into lines at position, counting the allocations for --stats
+static void insertLines(vector<string>& lines, vector<string>::iterator position, vector<string>::const_iterator begin,
+                        vector<string>::const_iterator end) {
+    size_t capacity = lines.capacity();
+    position = lines.insert(position, begin, end);
+    countGrowth(Subsystem::CODE_BUFFER, lines, capacity);
+    for (; begin != end; ++begin, ++position) {
+        countString(Subsystem::CODE_BUFFER, *position);
+    }
+}
+
+//appends line to lines, counting the allocations for --stats
+static void addLine(vector<string>& lines, string line) {
+    size_t capacity = lines.capacity();
+    lines.push_back(std::move(line));
+    countGrowth(Subsystem::CODE_BUFFER, lines, capacity);
+    countString(Subsystem::CODE_BUFFER, lines.back());
+}
+
+CodeBuffer::CodeBuffer() : buffer(), globalDefs(), coldCode(), emittingCold(false), functionStrings() {}
 
 CodeBuffer& CodeBuffer::instance() {
-    static CodeBuffer inst;  // only instance
-    return inst;
+    return Compilation::current().codeBuffer;
 }
 
 string CodeBuffer::genLabel(const string& prefix) {
+    string ret = genPhiLabel(prefix);
+    if (Profile* profile = Compilation::current().profile) {
+        profile->countBlock();
+    }
+    return ret;
+}
+
+string CodeBuffer::genPhiLabel(const string& prefix) {
     std::stringstream label;
     if (prefix != "") {
         label << prefix << "_label_";
     } else {
         label << "label_";
     }
+    countStat(&CompileStats::labels);
     label << buffer.size();
     std::string ret(label.str());
     label << ":";
@@ -35,49 +67,113 @@ string CodeBuffer::genLabel(const string& prefix) {
     return ret;
 }
 
-extern SymbolTable symbolTable;
-
 int CodeBuffer::emit(const string& s, bool canSkip) {
-    int indentationDepth = symbolTable.getCurrentScopeDepth();
+    PhaseScope phase(Phase::EMIT);
+    int indentationDepth = SymbolTable::instance().getCurrentScopeDepth();
     string indentationStr(indentationDepth, '\t');
+    vector<string>& target = emittingCold ? coldCode : buffer;
     // Skip both this and prev emit start with br
-    if (canSkip and s.substr(0, 9) == "br label " and (buffer.back().find("br ") != string::npos or buffer.back().find("ret ") != string::npos)) {
+    if (canSkip and s.substr(0, 9) == "br label " and
+        (target.empty() or target.back().find("br ") != string::npos or target.back().find("ret ") != string::npos or
+         target.back().find("unreachable") != string::npos)) {
         return -1;
     }
 
-    buffer.push_back(indentationStr + s + " ; " + to_string(yylineno));
-    return buffer.size() - 1;
+    string location;
+    if (DebugInfo* debugInfo = Compilation::current().debugInfo) {
+        location = debugInfo->getLocation(s);
+    }
+    addLine(target, indentationStr + s + location + " ; " + to_string(yylineno));
+    return emittingCold ? -1 : buffer.size() - 1;
+}
+
+void CodeBuffer::startColdCode() {
+    emittingCold = true;
+}
+
+void CodeBuffer::endColdCode() {
+    emittingCold = false;
+}
+
+void CodeBuffer::emitColdCode() {
+    PhaseScope phase(Phase::EMIT);
+    insertLines(buffer, buffer.end(), coldCode.begin(), coldCode.end());
+    coldCode.clear();
+}
+
+void CodeBuffer::setBranchWeights(int address, const string& weights) {
+    string& line = buffer[address];
+    if (line.compare(std::min(line.find_first_not_of('\t'), line.size()), 6, "br i1 ") != 0) {
+        throw Exception("Code error. Branch weights attached to a line that isn't a conditional branch: " + line);
+    }
+    if (line.find("!prof") != string::npos) {
+        return;
+    }
+    // Before the line number comment
+    line.insert(line.rfind(" ; "), ", !prof " + weights);
+}
+
+void CodeBuffer::setFunctionAttributes(int address, const string& attributes) {
+    string& line = buffer[address];
+    line.insert(line.find(')') + 1, " " + attributes);
+}
+
+void CodeBuffer::setFunctionName(int address, const string& name) {
+    string& line = buffer[address];
+    size_t start = line.find('@') + 1;
+    line.replace(start, line.find('(', start) - start, name);
+}
+
+void CodeBuffer::replaceCode(size_t begin, size_t end, const vector<string>& lines) {
+    buffer.erase(buffer.begin() + begin, buffer.begin() + end);
+    insertLines(buffer, buffer.begin() + begin, lines.begin(), lines.end());
 }
 
 void CodeBuffer::bpatch(vector<pair<int, BranchLabelIndex>>& address_list, const std::string& label) {
+    PhaseScope phase(Phase::BACKPATCH);
     for (vector<pair<int, BranchLabelIndex>>::const_iterator i = address_list.begin(); i != address_list.end(); i++) {
         int address = (*i).first;
         if (address == -1) {
             continue;
         }
         BranchLabelIndex labelIndex = (*i).second;
+        countStat(&CompileStats::backpatches);
         replace(buffer[address], "@", "%" + label, labelIndex);
     }
     address_list.clear();
 }
 
 void CodeBuffer::bpatch(pair<int, BranchLabelIndex> pair, const std::string& label) {
+    PhaseScope phase(Phase::BACKPATCH);
+    countStat(&CompileStats::backpatches);
     int address = pair.first;
     BranchLabelIndex labelIndex = pair.second;
     replace(buffer[address], "@", "%" + label, labelIndex);
 }
 
-void CodeBuffer::printCodeBuffer() {
+void CodeBuffer::printCodeBuffer(OutputWriter& out) {
     for (std::vector<string>::const_iterator it = buffer.begin(); it != buffer.end(); ++it) {
         // Check if "label @" in in *it
-        if (it->find("label @") == string::npos) {
-            cout << *it << endl;
-        } else {
-            cout << "; DEBUG: removed> " << *it << endl;
+        if (it->find("label @") != string::npos) {
+            out.write("; DEBUG: removed> ");
         }
+        out.writeLine(*it);
     }
 }
 
+void CodeBuffer::emitVerbatim(const string& line) {
+    PhaseScope phase(Phase::EMIT);
+    addLine(buffer, line);
+}
+
+size_t CodeBuffer::getCodeSize() const {
+    return buffer.size();
+}
+
+const string& CodeBuffer::getCodeLine(size_t location) const {
+    return buffer[location];
+}
+
 vector<pair<int, BranchLabelIndex>> CodeBuffer::makelist(pair<int, BranchLabelIndex> item) {
     vector<pair<int, BranchLabelIndex>> newList;
     newList.push_back(item);
@@ -92,12 +188,67 @@ vector<pair<int, BranchLabelIndex>> CodeBuffer::merge(const vector<pair<int, Bra
 
 // ******** Methods to handle the global section ********** //
 void CodeBuffer::emitGlobal(const std::string& dataLine) {
-    globalDefs.push_back(dataLine);
+    PhaseScope phase(Phase::EMIT);
+    addLine(globalDefs, dataLine);
+}
+
+string CodeBuffer::getStringConstant(const string& literal) {
+    // FNV-1a, 64 bit
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : literal) {
+        hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "@.str.%016llx", (unsigned long long)hash);
+    string arrayType = "[" + to_string(literal.size() + 1) + " x i8]";
+    if (functionStrings.insert(name).second) {
+        countStat(&CompileStats::stringConstants);
+        emitGlobal(string(name) + " = private unnamed_addr constant " + arrayType + " c\"" + literal + "\\00\"");
+    } else {
+        countStat(&CompileStats::reusedStringConstants);
+    }
+    return "getelementptr inbounds (" + arrayType + ", " + arrayType + "* " + name + ", i32 0, i32 0)";
 }
 
-void CodeBuffer::printGlobalBuffer() {
+void CodeBuffer::startFunctionStrings() {
+    functionStrings.clear();
+}
+
+void CodeBuffer::printGlobalBuffer(OutputWriter& out) {
     for (vector<string>::const_iterator it = globalDefs.begin(); it != globalDefs.end(); ++it) {
-        cout << *it << endl;
+        out.writeLine(*it);
+    }
+}
+
+size_t CodeBuffer::getGlobalSize() const {
+    return globalDefs.size();
+}
+
+const string& CodeBuffer::getGlobalLine(size_t location) const {
+    return globalDefs[location];
+}
+
+void CodeBuffer::removeLines(const vector<bool>& deadGlobals, const vector<bool>& deadCode) {
+    auto remove = [](vector<string>& lines, const vector<bool>& dead) {
+        size_t kept = 0;
+        for (size_t i = 0; i < lines.size(); i++) {
+            if (not dead[i]) {
+                if (kept != i) {
+                    lines[kept] = std::move(lines[i]);
+                }
+                kept++;
+            }
+        }
+        lines.resize(kept);
+    };
+    remove(globalDefs, deadGlobals);
+    remove(buffer, deadCode);
+}
+
+void traceBufferSize(const CodeBuffer& buffer) {
+    if (activeTrace) {
+        activeTrace->counter("buffer size", "\"code lines\": " + to_string(buffer.getCodeSize()) +
+                                                ", \"global lines\": " + to_string(buffer.getGlobalSize()));
     }
 }
 
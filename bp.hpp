@@ -3,6 +3,9 @@
 
 #include <vector>
 #include <string>
+#include <unordered_set>
+
+#include "io.hpp"
 
 using namespace std;
 
@@ -14,18 +17,27 @@ typedef pair<int,BranchLabelIndex> AddressIndPair;
 typedef vector<AddressIndPair> AddressList;
 
 class CodeBuffer{
+	friend class Compilation;
 	CodeBuffer();
 	CodeBuffer(CodeBuffer const&);
     void operator=(CodeBuffer const&);
 	std::vector<std::string> buffer;
 	std::vector<std::string> globalDefs;
+	//code set aside for the end of the function being emitted, and whether emitted code goes there
+	std::vector<std::string> coldCode;
+	bool emittingCold;
+	//names of the string constants the function being emitted defined in the global section
+	std::unordered_set<std::string> functionStrings;
 public:
+	//the code buffer of the current compilation
 	static CodeBuffer &instance();
 
 	// ******** Methods to handle the code section ******** //
 
 	//generates a jump location label for the next command, writes it to the buffer and returns it
 	std::string genLabel(const string& prefix = "");
+	//like genLabel, for a block starting with phis. --profile doesn't count it, as nothing may come before them
+	std::string genPhiLabel(const string& prefix);
 
 	//writes command to the buffer, returns its location in the buffer
 	int emit(const std::string &command, bool canSkip = false);
@@ -54,16 +66,52 @@ public:
 	
 	void bpatch(pair<int, BranchLabelIndex> pair, const std::string& label);
 
-	//prints the content of the code buffer to stdout
-	void printCodeBuffer();
+	//writes the content of the code buffer to out
+	void printCodeBuffer(OutputWriter &out);
+
+	//until endColdCode, emitted code is set aside for emitColdCode to place at the end of the function, out of the
+	//way of its hot code. it must end with a terminator, and can't be backpatched
+	void startColdCode();
+	void endColdCode();
+	void emitColdCode();
+
+	//attaches branch weights metadata (e.g. "!1") to the conditional branch at address, unless it has some already
+	void setBranchWeights(int address, const std::string &weights);
+	//adds attributes (e.g. "nounwind readnone") to the function defined at address, after its parameters
+	void setFunctionAttributes(int address, const std::string &attributes);
+	//renames the function defined at address to name (without the '@')
+	void setFunctionName(int address, const std::string &name);
+	//replaces the lines of the code buffer from begin up to end with lines
+	void replaceCode(size_t begin, size_t end, const std::vector<std::string> &lines);
+
+	//appends a line to the code buffer as is, without indentation or a line number
+	void emitVerbatim(const std::string &line);
+	//number of lines in the code buffer, which is also the location of the next emitted command
+	size_t getCodeSize() const;
+	const std::string &getCodeLine(size_t location) const;
 
 	// ******** Methods to handle the data section ******** //
 	//write a line to the global section
 	void emitGlobal(const string& dataLine);
-	//print the content of the global buffer to stdout
-	void printGlobalBuffer();
-
+	//returns a pointer to the string constant holding literal (the contents of a c"..." string, without its '\0'), as a
+	//constant expression to pass to a call. the constant is named after its contents, so each distinct string gets one,
+	//and is defined in the global section the first time each function uses it. that way a function's globals define
+	//all it uses, for the function cache, and removeDeadDefinitions drops the repeats once the program is lowered
+	std::string getStringConstant(const std::string& literal);
+	//starts a function, which defines the string constants it uses again
+	void startFunctionStrings();
+	//write the content of the global buffer to out
+	void printGlobalBuffer(OutputWriter &out);
+	//number of lines in the global section
+	size_t getGlobalSize() const;
+	const std::string &getGlobalLine(size_t location) const;
+
+	//drops the lines of the global section and of the code buffer that are marked in deadGlobals and deadCode
+	void removeLines(const std::vector<bool> &deadGlobals, const std::vector<bool> &deadCode);
 };
 
+//records the size of the code buffer in the trace, if tracing
+void traceBufferSize(const CodeBuffer &buffer);
+
 #endif
 
@@ -0,0 +1,180 @@
+"""Check the command line options whose effect the .in/.out tests can't see, each on the tests it needs.
+
+Usage: python3 check_options.py [--hw5 ./hw5]
+Exits with status 1 if any check failed.
+"""
+import argparse
+import json
+import os
+import signal
+import subprocess
+import tempfile
+import time
+
+RED = '\033[1;31m'
+GREEN = '\033[0;32m'
+NC = '\033[0m'
+
+TESTS_FOLDER = './tests/'
+# A test printing both strings and numbers, from both main and a function
+SAMPLE_TEST = './tests/course_tests/t1.in'
+
+CHECKS = []
+
+
+def check(function):
+    CHECKS.append(function)
+    return function
+
+
+class CheckFailed(Exception):
+    pass
+
+
+def expect(condition, message):
+    if not condition:
+        raise CheckFailed(message)
+
+
+def run(command, **kwargs):
+    return subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, **kwargs)
+
+
+def compile_ir(hw5, options, source, ir_path):
+    compile_process = run([hw5] + options + [source, '-o', ir_path])
+    expect(compile_process.returncode == 0, f'hw5 {" ".join(options)} {source} failed: {compile_process.stderr.decode()}')
+    with open(ir_path, 'rb') as ir_file:
+        return ir_file.read()
+
+
+def expected_output(source):
+    with open(source.replace('.in', '.out'), 'rb') as out_file:
+        return out_file.read().replace(b'\r\n', b'\n')
+
+
+def wait_for_socket(socket_path, timeout=5.0):
+    deadline = time.monotonic() + timeout
+    while not os.path.exists(socket_path):
+        expect(time.monotonic() < deadline, f'server did not create {socket_path}')
+        time.sleep(0.01)
+
+
+@check
+def server_round_trip(hw5, directory):
+    """The IR a client gets from a server is what compiling the source directly gives"""
+    socket_path = os.path.join(directory, 'hw5.sock')
+    server = subprocess.Popen([hw5, '--server', socket_path, '-j', '2'], stderr=subprocess.PIPE)
+    try:
+        wait_for_socket(socket_path)
+        for source in [SAMPLE_TEST, './tests/students_tests_my_own/gcd_test1.in']:
+            direct = compile_ir(hw5, [], source, os.path.join(directory, 'direct.ll'))
+            client = run([hw5, '--client', socket_path, source])
+            expect(client.returncode == 0, f'client failed on {source}: {client.stderr.decode()}')
+            expect(client.stdout == direct, f'IR from the server differs from compiling {source} directly')
+    finally:
+        server.send_signal(signal.SIGTERM)
+        server.communicate()
+    expect(not os.path.exists(socket_path), 'server left its socket behind after SIGTERM')
+
+
+CACHED_SOURCE = """int helper(int n) {
+    return n + 1;
+}
+
+int caller(int n) {
+    return helper(n) * 2;
+}
+
+int other(int n) {
+    return n - 1;
+}
+
+void main() {
+    printi(caller(other(3)));
+}
+"""
+
+
+def compile_with_cache(hw5, source, cache_directory, ir_path):
+    compile_process = run([hw5, '--cache', cache_directory, '--stats=json', source, '-o', ir_path])
+    expect(compile_process.returncode == 0, f'hw5 --cache failed: {compile_process.stderr.decode()}')
+    with open(ir_path, 'rb') as ir_file:
+        return ir_file.read(), json.loads(compile_process.stderr)['cachedFunctions']
+
+
+@check
+def function_cache(hw5, directory):
+    """Recompiling reuses every function, and a function whose callee gains effects is lowered again"""
+    source = os.path.join(directory, 'cached.in')
+    cache_directory = os.path.join(directory, 'cache')
+    with open(source, 'w') as source_file:
+        source_file.write(CACHED_SOURCE)
+    uncached = compile_ir(hw5, [], source, os.path.join(directory, 'uncached.ll'))
+    cold, cold_hits = compile_with_cache(hw5, source, cache_directory, os.path.join(directory, 'cold.ll'))
+    warm, warm_hits = compile_with_cache(hw5, source, cache_directory, os.path.join(directory, 'warm.ll'))
+    expect(cold == uncached and warm == uncached, 'IR compiled with the cache differs from compiling without it')
+    expect(cold_hits == 0 and warm_hits == 4, f'expected 0 then 4 cached functions, got {cold_hits} then {warm_hits}')
+
+    # helper now prints, so caller and main, which call it, can't keep their attributes. Only other is still cached
+    with open(source, 'w') as source_file:
+        source_file.write(CACHED_SOURCE.replace('    return n + 1;', '    printi(n);\n    return n + 1;'))
+    uncached = compile_ir(hw5, [], source, os.path.join(directory, 'uncached.ll'))
+    edited, edited_hits = compile_with_cache(hw5, source, cache_directory, os.path.join(directory, 'edited.ll'))
+    expect(edited == uncached, 'IR compiled with the cache after an edit differs from compiling without it')
+    expect(edited_hits == 1, f'expected only other to be cached after helper gained effects, got {edited_hits} cached functions')
+
+
+@check
+def profile_counts(hw5, directory):
+    """A program built with --profile still prints what it did, then reports its calls and lines to stderr"""
+    ir_path = os.path.join(directory, 'profile.ll')
+    compile_ir(hw5, ['--profile'], SAMPLE_TEST, ir_path)
+    with open(ir_path) as ir_file:
+        program = run(['lli'], stdin=ir_file)
+    expect(program.stdout == expected_output(SAMPLE_TEST), 'a program built with --profile printed something else')
+    report = program.stderr.decode().splitlines()
+    for expected_line in ['2 calls of printByValue', '1 calls of main', '2 hits of line 1 in printByValue']:
+        expect(any(line.strip() == expected_line for line in report), f'profile report is missing "{expected_line}"')
+
+
+@check
+def debug_info_verifies(hw5, directory):
+    """The IR of every test compiled with -g passes the LLVM verifier, debug info included"""
+    ir_path = os.path.join(directory, 'debug.ll')
+    for root, _, files in os.walk(TESTS_FOLDER):
+        for test_in in sorted(name for name in files if name.endswith('.in')):
+            source = os.path.join(root, test_in)
+            compile_ir(hw5, ['-g'], source, ir_path)
+            verify = run(['opt', '-verify', '-disable-output', ir_path])
+            expect(verify.returncode == 0, f'-g IR of {source} does not verify: {verify.stderr.decode()}')
+
+
+@check
+def native_build(hw5, directory):
+    """An executable built with -O prints what lli does, and exits with status 0"""
+    executable = os.path.join(directory, 'program')
+    for level in ['-O0', '-O2']:
+        build = run([hw5, level, SAMPLE_TEST, '-o', executable])
+        expect(build.returncode == 0, f'hw5 {level} failed: {build.stderr.decode()}')
+        program = run([executable])
+        expect(program.stdout == expected_output(SAMPLE_TEST), f'the {level} executable printed something else')
+        expect(program.returncode == 0, f'the {level} executable exited with status {program.returncode}')
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--hw5', default='./hw5')
+    args = parser.parse_args()
+
+    failed = []
+    for function in CHECKS:
+        with tempfile.TemporaryDirectory() as directory:
+            try:
+                function(os.path.abspath(args.hw5), directory)
+                print(f'{GREEN}PASSED{NC} {function.__name__}')
+            except (CheckFailed, OSError) as error:
+                failed.append(function.__name__)
+                print(f'{RED}FAILED{NC} {function.__name__}: {error}')
+    if failed:
+        exit(1)
+    print(f'{GREEN}ALL CHECKS PASSED ({len(CHECKS)}/{len(CHECKS)}){NC}')
@@ -0,0 +1,293 @@
+#include "compilation.hpp"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "deadCode.hpp"
+#include "debugInfo.hpp"
+#include "evaluate.hpp"
+#include "funcCache.hpp"
+#include "hw3_output.hpp"
+#include "loops.hpp"
+#include "memo.hpp"
+#include "native.hpp"
+#include "profile.hpp"
+#include "specialize.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "io.hpp"
+#include "parser.tab.hpp"
+#include "tokenStream.hpp"
+#include "tokens.hpp"
+
+using std::string;
+
+thread_local int yylineno = 1;
+
+thread_local Compilation *Compilation::currentCompilation = nullptr;
+
+Compilation::Activation::Activation(Compilation *compilation) : previous(currentCompilation) {
+    currentCompilation = compilation;
+    yylineno = 1;
+}
+
+Compilation::Activation::~Activation() {
+    currentCompilation = this->previous;
+}
+
+Compilation::Compilation() : activation(this), interner(), ralloc(), codeBuffer(), symbolTable(), lastScBool(), functionCache(nullptr), profile(nullptr), debugInfo(nullptr), memoizer(nullptr), specializer(nullptr), evaluator(nullptr), unroller(nullptr) {}
+
+Compilation &Compilation::current() {
+    if (not currentCompilation) {
+        throw Exception("Code error. No compilation is running on this thread");
+    }
+    return *currentCompilation;
+}
+
+void reportError(const string &message) {
+    std::cerr << "hw5: " + message + "\n";
+}
+
+// Cached IR has no counters, debug info, memoization, specialization, evaluated calls or unrolled loops, so those
+// lower every function
+static bool canUseFunctionCache(const CompileOptions &options) {
+    return not options.profile and not options.debugInfo and not options.memoize and not options.specialize and
+           options.evaluationFuel == 0 and options.unrollFactor == 0;
+}
+
+static bool compile(SourceFile &source, OutputWriter &out, const char *sourceName, const CompileOptions &options) {
+    Compilation compilation;
+    try {
+        // Keep the whole source in memory so tokens can be views into it instead of copies
+        std::unique_ptr<TokenStream> tokens;
+        {
+            PhaseScope phase(Phase::LEX);
+            tokens.reset(new TokenStream(source));
+        }
+        if (activeStats) {
+            // Not counting EOF
+            activeStats->tokens = tokens->getTokens().size() - 1;
+        }
+
+        std::unique_ptr<Profile> profile;
+        if (options.profile) {
+            profile.reset(new Profile());
+            compilation.profile = profile.get();
+        }
+        std::unique_ptr<DebugInfo> debugInfo;
+        if (options.debugInfo) {
+            debugInfo.reset(new DebugInfo(sourceName));
+            compilation.debugInfo = debugInfo.get();
+        }
+        std::unique_ptr<Memoizer> memoizer;
+        if (options.memoize) {
+            memoizer.reset(new Memoizer());
+            compilation.memoizer = memoizer.get();
+        }
+        std::unique_ptr<Specializer> specializer;
+        // Clones would share the debug info of the functions they were cloned from, so -g leaves them out
+        if (options.specialize and not options.debugInfo) {
+            specializer.reset(new Specializer());
+            compilation.specializer = specializer.get();
+        }
+        std::unique_ptr<Evaluator> evaluator;
+        // Evaluating would skip the counters of --profile
+        if (options.evaluationFuel > 0 and not options.profile) {
+            evaluator.reset(new Evaluator(options.evaluationFuel));
+            compilation.evaluator = evaluator.get();
+        }
+        std::unique_ptr<Unroller> unroller;
+        if (options.unrollFactor > 0) {
+            unroller.reset(new Unroller(options.unrollFactor, options.unrollBudget));
+            compilation.unroller = unroller.get();
+        }
+
+        std::unique_ptr<FunctionCache> functionCache;
+        if (options.cacheDirectory and canUseFunctionCache(options)) {
+            PhaseScope phase(Phase::CACHE);
+            functionCache.reset(new FunctionCache(FunctionCache::getCachePath(options.cacheDirectory, sourceName)));
+            functionCache->load();
+            functionCache->prepare(tokens->getTokens());
+            compilation.functionCache = functionCache.get();
+        }
+
+        {
+            PhaseScope phase(Phase::PARSE);
+            yy::parser parser(*tokens);
+            parser.parse();
+        }
+        if (evaluator) {
+            evaluator->evaluateProgram();
+        }
+        if (profile) {
+            profile->finish();
+        }
+        if (debugInfo) {
+            debugInfo->finish();
+        }
+
+        if (functionCache) {
+            PhaseScope phase(Phase::CACHE);
+            if (not functionCache->save()) {
+                reportError(string(sourceName) + ": saving function cache: " + strerror(errno));
+            }
+        }
+        {
+            PhaseScope phase(Phase::PRINT);
+            removeDeadDefinitions(compilation.codeBuffer);
+            if (options.optimizationLevel >= 0) {
+                emitNativeEntry(compilation.codeBuffer);
+            }
+            compilation.codeBuffer.printGlobalBuffer(out);
+            compilation.codeBuffer.printCodeBuffer(out);
+        }
+        if (activeStats) {
+            activeStats->codeLines = compilation.codeBuffer.getCodeSize();
+            activeStats->globalLines = compilation.codeBuffer.getGlobalSize();
+        }
+        verifyMainExists(compilation.symbolTable);
+    } catch (const CompileError &e) {
+        out.writeLine(e.what());
+        return false;
+    } catch (const Exception &e) {
+        reportError(string(sourceName) + ": internal error: " + e.what());
+        return false;
+    } catch (const std::exception &e) {
+        // Like std::out_of_range from stoi. Only this source fails, the server and batch go on
+        reportError(string(sourceName) + ": internal error: " + e.what());
+        return false;
+    }
+    return true;
+}
+
+bool compileSource(SourceFile &source, OutputWriter &out, const char *sourceName, const CompileOptions &options) {
+    const bool collectStats = options.statsFormat != StatsFormat::NONE;
+    if (not collectStats and not options.tracePath) {
+        return compile(source, out, sourceName, options);
+    }
+
+    CompileStats stats;
+    bool compiled;
+    {
+        std::unique_ptr<StatsCollection> statsCollection(collectStats ? new StatsCollection(stats) : nullptr);
+        std::unique_ptr<TraceCollection> traceCollection(options.tracePath ? new TraceCollection(sourceName) : nullptr);
+        compiled = compile(source, out, sourceName, options);
+    }
+    if (collectStats) {
+        // At once, so reports from different threads don't interleave
+        std::cerr << stats.format(options.statsFormat, sourceName);
+    }
+    return compiled;
+}
+
+// Compile source to IR in a temporary file, and build the executable outputPath from it
+static bool compileNative(SourceFile &source, const char *outputPath, const char *sourceName, const CompileOptions &options) {
+    string irPath = getTemporaryDirectory() + "/hw5-XXXXXX.ll";
+    int fd = mkstemps(&irPath[0], 3);
+    if (fd == -1) {
+        reportError(string("creating temporary file: ") + strerror(errno));
+        return false;
+    }
+
+    bool ok;
+    {
+        OutputWriter out(fd);
+        ok = compileSource(source, out, sourceName, options);
+        if (not out.flush()) {
+            reportError(irPath + ": " + strerror(errno));
+            ok = false;
+        }
+    }
+    close(fd);
+
+    if (ok) {
+        NativeBuild build = {options.optimizationLevel, options.cacheDirectory, options.statsFormat};
+        ok = build.build(irPath, outputPath, sourceName);
+    } else {
+        // The compile error, as it would be written instead of the IR
+        SourceFile error;
+        if (error.open(irPath.c_str())) {
+            OutputWriter out;
+            out.write(error.getSource(), error.getSourceSize());
+            out.flush();
+        }
+    }
+    unlink(irPath.c_str());
+    return ok;
+}
+
+bool compileFile(const char *inputPath, const char *outputPath, const CompileOptions &options) {
+    const char *inputName = inputPath ? inputPath : "stdin";
+    SourceFile source;
+    if (not source.open(inputPath)) {
+        reportError(string(inputName) + ": " + strerror(errno));
+        return false;
+    }
+
+    if (options.optimizationLevel >= 0) {
+        return compileNative(source, outputPath ? outputPath : "a.out", inputName, options);
+    }
+
+    OutputWriter out;
+    if (outputPath and not out.open(outputPath)) {
+        reportError(string(outputPath) + ": " + strerror(errno));
+        return false;
+    }
+
+    compileSource(source, out, inputName, options);
+
+    if (not out.flush()) {
+        reportError(string(outputPath ? outputPath : "stdout") + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// a.fanc is compiled to a.ll, or to the executable a
+static string getBatchOutputPath(const string &inputPath, bool native) {
+    size_t dot = inputPath.find_last_of('.');
+    size_t slash = inputPath.find_last_of('/');
+    const char *extension = native ? "" : ".ll";
+
+    if (dot == string::npos or (slash != string::npos and dot < slash)) {
+        return inputPath + extension;
+    }
+    return inputPath.substr(0, dot) + extension;
+}
+
+bool compileBatch(const std::vector<const char *> &inputPaths, int jobs, const CompileOptions &options) {
+    std::atomic<size_t> nextInput(0);
+    std::atomic<bool> ok(true);
+
+    // Workers take the next source off the list until it runs out, so a slow source doesn't hold up the others
+    auto worker = [&]() {
+        size_t i;
+        while ((i = nextInput++) < inputPaths.size()) {
+            string outputPath = getBatchOutputPath(inputPaths[i], options.optimizationLevel >= 0);
+            if (outputPath == inputPaths[i]) {
+                reportError(outputPath + ": input would be overwritten by its output");
+                ok = false;
+            } else if (not compileFile(inputPaths[i], outputPath.c_str(), options)) {
+                ok = false;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < jobs and (size_t)i < inputPaths.size(); i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    return ok;
+}
@@ -0,0 +1,106 @@
+#ifndef COMPILATION_H_
+#define COMPILATION_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bp.hpp"
+#include "interner.hpp"
+#include "io.hpp"
+#include "ralloc.hpp"
+#include "stypes.hpp"
+#include "stats.hpp"
+#include "symbolTable.hpp"
+
+class DebugInfo;
+class Evaluator;
+class FunctionCache;
+class Memoizer;
+class Profile;
+class Specializer;
+class Unroller;
+
+// How to compile, as given on the command line
+struct CompileOptions {
+    // Directory of the function cache, or null to lower every function
+    const char *cacheDirectory = nullptr;
+    // Report how long each phase took and what it allocated to stderr, and in what format
+    StatsFormat statsFormat = StatsFormat::NONE;
+    // Where to write a trace of the compilation, or null
+    const char *tracePath = nullptr;
+    // Make the program count how often each of its lines, functions and loops run, and report it to stderr at exit
+    bool profile = false;
+    // Emit DWARF debug info mapping the program's code to FanC functions, lines and variables
+    bool debugInfo = false;
+    // Memoize pure recursive functions
+    bool memoize = false;
+    // Call clones of functions specialized for the literal arguments of calls
+    bool specialize = false;
+    // Evaluate what the program computes at compile time, interpreting at most this many instructions, or 0
+    int64_t evaluationFuel = 0;
+    // Unroll loops with trip counts known at compile time, by this factor when they are too long to unroll fully, or 0
+    int unrollFactor = 0;
+    // Lines of copies of its body a loop may be unrolled into
+    size_t unrollBudget = 400;
+    // Build a native executable optimized at this -O level instead of writing the IR, or -1
+    int optimizationLevel = -1;
+};
+
+// All the state of compiling a single source. A compilation is current on the thread that creates it for its whole
+// lifetime, and the singletons (CodeBuffer, Ralloc, Interner, SymbolTable) resolve to the members of the calling
+// thread's current compilation, so separate threads can compile separate sources at the same time
+class Compilation {
+   private:
+    static thread_local Compilation *currentCompilation;
+
+    // Makes the compilation current before the other members are constructed, since SymbolTable's constructor
+    // already uses the singletons, and restores the previous one after they are destroyed
+    struct Activation {
+        Compilation *previous;
+        explicit Activation(Compilation *compilation);
+        ~Activation();
+    } activation;
+
+   public:
+    Interner interner;
+    Ralloc ralloc;
+    CodeBuffer codeBuffer;
+    SymbolTable symbolTable;
+    // The condition of the if statement being parsed
+    ShortCircuitBool lastScBool;
+    // Told about each function as it is lowered, if caching is on
+    FunctionCache *functionCache;
+    // Told where to count executions in the program, if profiling
+    Profile *profile;
+    // Told about functions and variables, and gives code its locations, if emitting debug info
+    DebugInfo *debugInfo;
+    // Told about each function once it is lowered, if memoizing
+    Memoizer *memoizer;
+    // Told about each function once it is lowered and about each call, if specializing
+    Specializer *specializer;
+    // Asked to evaluate each call and the whole program, if evaluating
+    Evaluator *evaluator;
+    // Told about each loop once it is lowered, if unrolling
+    Unroller *unroller;
+
+    Compilation();
+    Compilation(const Compilation &) = delete;
+    void operator=(const Compilation &) = delete;
+    // Get the calling thread's current compilation
+    static Compilation &current();
+};
+
+// Compile source to out, on the calling thread. Compile errors are written to out instead of the IR. sourceName names
+// the source's function cache, and is used in error reports. Returns false if out got an error instead of the IR
+bool compileSource(SourceFile &source, OutputWriter &out, const char *sourceName, const CompileOptions &options);
+// Compile the source at inputPath (stdin if null) to outputPath (stdout if null). Compile errors are written to the
+// output instead of the IR. With an optimization level, outputPath is the native executable to build instead, and
+// compile errors go to stdout. Returns false if the input or output couldn't be opened, or the build failed
+bool compileFile(const char *inputPath, const char *outputPath, const CompileOptions &options);
+// Compile each source to a .ll file (or with an optimization level, an executable) next to it, on jobs threads. Returns false if any input or output couldn't be opened
+bool compileBatch(const std::vector<const char *> &inputPaths, int jobs, const CompileOptions &options);
+// Write "hw5: message" to stderr at once, so messages from different threads don't interleave
+void reportError(const std::string &message);
+
+#endif
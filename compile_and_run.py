@@ -14,6 +14,27 @@ def clear_row():
     clear_the_line_proc = subprocess.Popen(["tput", "el"])
     clear_the_line_proc.communicate()
 
+OPTIONS_DIRECTIVE = "// hw5 options:"
+
+# Compile all tests in one hw5 process. Each test.in is compiled to test.ll. A test whose first line is
+# "// hw5 options: ..." is compiled on its own with those options
+all_tests_in = []
+tests_with_options = []
+for root, _, _ in os.walk(f"{MAIN_TESTS_FOLDER}"):
+    for test_in in glob.glob(f"{root}/*.in"):
+        with open(test_in) as test_in_file:
+            first_line = test_in_file.readline().strip()
+        if first_line.startswith(OPTIONS_DIRECTIVE):
+            tests_with_options.append((test_in, first_line[len(OPTIONS_DIRECTIVE):].split()))
+        else:
+            all_tests_in.append(test_in)
+
+compile_process = subprocess.Popen(["./hw5", "--batch", "-j", str(os.cpu_count() or 1)] + all_tests_in, stderr=subprocess.PIPE)
+_, compile_stderr = compile_process.communicate()
+for test_in, options in tests_with_options:
+    compile_process = subprocess.Popen(["./hw5"] + options + [test_in, "-o", test_in.replace('.in', '.ll')], stderr=subprocess.PIPE)
+    compile_stderr += compile_process.communicate()[1]
+
 # Run tests
 total_tests_count = 0
 successful_tests_count = 0
@@ -45,16 +66,13 @@ for root, _, _ in os.walk(f"{MAIN_TESTS_FOLDER}"):
             test_out_file.write(content)
 
 
-        # generate compiled llvm file for test.in
+        # take the compiled llvm file for test.in
         llvm_filename = f"{root}/{test_in_basename.replace('.in', '.our.ll')}"
-        fanC_file = open(test_in)
-        llvm_file = open(llvm_filename, 'w')
-
-        compile_process = subprocess.Popen("./hw5", stdin=fanC_file, stdout=llvm_file, stderr=subprocess.PIPE)
-        _, compile_stderr = compile_process.communicate()
-
-        fanC_file.close()
-        llvm_file.close()
+        batch_llvm_filename = f"{root}/{test_in_basename.replace('.in', '.ll')}"
+        if os.path.exists(batch_llvm_filename):
+            os.replace(batch_llvm_filename, llvm_filename)
+        else:
+            open(llvm_filename, 'w').close()
 
         # run lli on generated file
         fanC_out_filename = f"{root}/{test_in_basename.replace('.in', '.our.out')}"
@@ -0,0 +1,133 @@
+#include "deadCode.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "irText.hpp"
+#include "stats.hpp"
+
+using std::string;
+using std::vector;
+
+// A function, declaration or global, from its first line to its last in one of the sections
+struct Definition {
+    bool inGlobals;
+    size_t begin;
+    size_t end;
+    vector<size_t> uses;
+    bool live;
+    // Defines again what an earlier definition defined, like a string constant each function using it defines
+    bool repeated;
+};
+
+// The names line refers to, without the '@'
+static void forEachName(const string &line, const std::function<void(const string &)> &visit) {
+    for (size_t sigil = line.find('@'); sigil != string::npos; sigil = line.find('@', sigil + 1)) {
+        size_t end = sigil + 1;
+        while (end < line.size() and isNameChar(line[end])) {
+            end++;
+        }
+        if (end > sigil + 1) {
+            visit(line.substr(sigil + 1, end - sigil - 1));
+        }
+    }
+}
+
+// The name a line starting a definition defines, or ""
+static string getDefinedName(const string &body) {
+    if (body.compare(0, 7, "define ") == 0 or body.compare(0, 8, "declare ") == 0) {
+        size_t start = body.find('@');
+        size_t end = body.find('(', start);
+        return start == string::npos or end == string::npos ? "" : body.substr(start + 1, end - start - 1);
+    }
+    if (body.size() > 1 and body[0] == '@') {
+        return body.substr(1, body.find(' ') - 1);
+    }
+    return "";
+}
+
+void removeDeadDefinitions(CodeBuffer &buffer) {
+    vector<Definition> definitions;
+    std::unordered_map<string, size_t> byName;
+    // Names used outside of any definition, like in metadata, which are always live
+    vector<string> roots = {"main"};
+
+    auto scan = [&](bool inGlobals) {
+        size_t size = inGlobals ? buffer.getGlobalSize() : buffer.getCodeSize();
+        auto getLine = [&](size_t i) -> const string & { return inGlobals ? buffer.getGlobalLine(i) : buffer.getCodeLine(i); };
+        for (size_t i = 0; i < size; i++) {
+            string body = getBody(getLine(i));
+            string name = getDefinedName(body);
+            if (name.empty()) {
+                forEachName(getLine(i), [&](const string &used) { roots.push_back(used); });
+                continue;
+            }
+            Definition definition = {inGlobals, i, i, {}, false, byName.count(name) != 0};
+            if (body.compare(0, 7, "define ") == 0) {
+                while (definition.end + 1 < size and getBody(getLine(definition.end)) != "}") {
+                    definition.end++;
+                }
+            }
+            // Intrinsics and special globals like llvm.used are up to LLVM
+            if (name.compare(0, 5, "llvm.") == 0) {
+                roots.push_back(name);
+            }
+            byName.emplace(name, definitions.size());
+            definitions.push_back(definition);
+            i = definition.end;
+        }
+    };
+    scan(true);
+    scan(false);
+    for (auto &definition : definitions) {
+        for (size_t i = definition.begin; i <= definition.end; i++) {
+            forEachName(definition.inGlobals ? buffer.getGlobalLine(i) : buffer.getCodeLine(i), [&](const string &used) {
+                auto found = byName.find(used);
+                if (found != byName.end()) {
+                    definition.uses.push_back(found->second);
+                }
+            });
+        }
+    }
+
+    vector<size_t> reached;
+    for (auto &name : roots) {
+        auto found = byName.find(name);
+        if (found != byName.end() and not definitions[found->second].live) {
+            definitions[found->second].live = true;
+            reached.push_back(found->second);
+        }
+    }
+    while (not reached.empty()) {
+        size_t definition = reached.back();
+        reached.pop_back();
+        for (size_t used : definitions[definition].uses) {
+            if (not definitions[used].live) {
+                definitions[used].live = true;
+                reached.push_back(used);
+            }
+        }
+    }
+
+    // Drop the dead and repeated definitions, and the blank lines after dead functions
+    vector<bool> deadGlobals(buffer.getGlobalSize(), false);
+    vector<bool> deadCode(buffer.getCodeSize(), false);
+    for (auto &definition : definitions) {
+        if (definition.live) {
+            continue;
+        }
+        vector<bool> &dead = definition.inGlobals ? deadGlobals : deadCode;
+        size_t end = definition.end + 1;
+        while (definition.end > definition.begin and end < dead.size() and (definition.inGlobals ? buffer.getGlobalLine(end) : buffer.getCodeLine(end)).empty()) {
+            end++;
+        }
+        std::fill(dead.begin() + definition.begin, dead.begin() + end, true);
+        if (not definition.repeated) {
+            countStat(&CompileStats::deadDefinitions);
+        }
+    }
+    buffer.removeLines(deadGlobals, deadCode);
+}
@@ -0,0 +1,12 @@
+#ifndef DEAD_CODE_H_
+#define DEAD_CODE_H_
+
+#include "bp.hpp"
+
+// Once the program is lowered, drop the functions, declarations and globals that main can't reach from both sections
+// of buffer. The runtime (print, printi, error_division_by_zero and what they use) is always emitted up front, so it
+// stays only if the program uses it, and a user function is left out unless main calls it, directly or not. Of the
+// definitions of the same name, like those of a string constant used by several functions, only the first is kept
+void removeDeadDefinitions(CodeBuffer &buffer);
+
+#endif
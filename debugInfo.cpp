@@ -0,0 +1,132 @@
+#include "debugInfo.hpp"
+
+#include <unistd.h>
+
+#include <climits>
+
+#include "bp.hpp"
+#include "symbolTable.hpp"
+#include "tokens.hpp"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+static string ref(int node) {
+    return "!" + to_string(node);
+}
+
+// text as the contents of a metadata string
+static string escape(const string &text) {
+    string escaped;
+    for (char c : text) {
+        if (c == '"') {
+            escaped += "\\22";
+        } else if (c == '\\') {
+            escaped += "\\5C";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+DebugInfo::DebugInfo(const string &sourceName) : nodes(), basicTypes(), subprogram(-1), locations() {
+    char directory[PATH_MAX];
+    if (not getcwd(directory, sizeof(directory))) {
+        directory[0] = '\0';
+    }
+    this->file = this->addNode("!DIFile(filename: \"" + escape(sourceName) + "\", directory: \"" + escape(directory) + "\")");
+    this->unit = this->addNode("distinct !DICompileUnit(language: DW_LANG_C99, file: " + ref(this->file) +
+                               ", producer: \"hw5\", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)");
+}
+
+int DebugInfo::addNode(const string &node) {
+    this->nodes.push_back(node);
+    return PRELUDE_METADATA_NODES + this->nodes.size() - 1;
+}
+
+int DebugInfo::getBasicType(TypeName type) {
+    auto found = this->basicTypes.find((int)type);
+    if (found != this->basicTypes.end()) {
+        return found->second;
+    }
+
+    string node;
+    if (type == TypeName::INT) {
+        node = "!DIBasicType(name: \"int\", size: 32, encoding: DW_ATE_signed)";
+    } else if (type == TypeName::BYTE) {
+        node = "!DIBasicType(name: \"byte\", size: 8, encoding: DW_ATE_unsigned)";
+    } else {
+        node = "!DIBasicType(name: \"bool\", size: 8, encoding: DW_ATE_boolean)";
+    }
+    return this->basicTypes[(int)type] = this->addNode(node);
+}
+
+string DebugInfo::getLocation(const string &command) {
+    size_t start = command.find_first_not_of('\t');
+    if (this->subprogram == -1 or start == string::npos or command[start] == ';' or command[start] == '}' or
+        command.back() == ':' or command.compare(start, 7, "define ") == 0) {
+        return "";
+    }
+
+    auto found = this->locations.find(yylineno);
+    if (found == this->locations.end()) {
+        int location = this->addNode("!DILocation(line: " + to_string(yylineno) + ", scope: " + ref(this->subprogram) + ")");
+        found = this->locations.emplace(yylineno, location).first;
+    }
+    return ", !dbg " + ref(found->second);
+}
+
+string DebugInfo::startFunction(const string &name, TypeName retType, const vector<TypeName> &argTypes) {
+    string types = retType == TypeName::VOID ? "null" : ref(this->getBasicType(retType));
+    for (TypeName argType : argTypes) {
+        types += ", " + ref(this->getBasicType(argType));
+    }
+    int typeList = this->addNode("!{" + types + "}");
+    int subroutineType = this->addNode("!DISubroutineType(types: " + ref(typeList) + ")");
+    string line = to_string(yylineno);
+    this->subprogram = this->addNode("distinct !DISubprogram(name: \"" + name + "\", scope: " + ref(this->file) +
+                                     ", file: " + ref(this->file) + ", line: " + line + ", type: " + ref(subroutineType) +
+                                     ", scopeLine: " + line + ", spFlags: DISPFlagDefinition, unit: " + ref(this->unit) + ")");
+    this->locations.clear();
+    return " !dbg " + ref(this->subprogram);
+}
+
+int DebugInfo::addVariable(const string &name, TypeName type, int arg) {
+    return this->addNode("!DILocalVariable(name: \"" + name + "\"" + (arg ? ", arg: " + to_string(arg) : "") +
+                         ", scope: " + ref(this->subprogram) + ", file: " + ref(this->file) +
+                         ", line: " + to_string(yylineno) + ", type: " + ref(this->getBasicType(type)) + ")");
+}
+
+void DebugInfo::declareFormal(const string &name, TypeName type, int arg, const string &reg) {
+    int variable = this->addVariable(name, type, arg);
+    CodeBuffer::instance().emit("call void @llvm.dbg.value(metadata " + typeNameToLlvmType(type) + " " + reg +
+                                ", metadata " + ref(variable) + ", metadata !DIExpression())");
+}
+
+void DebugInfo::declareLocal(const string &name, TypeName type, int offset, const string &stackVariablesPtrReg) {
+    int variable = this->addVariable(name, type, 0);
+    // Every variable takes an i32 slot, and smaller ones its first bytes
+    string expression = offset == 0 ? "!DIExpression()" : "!DIExpression(DW_OP_plus_uconst, " + to_string(offset * 4) + ")";
+    CodeBuffer::instance().emit("call void @llvm.dbg.declare(metadata i32* " + stackVariablesPtrReg + ", metadata " +
+                                ref(variable) + ", metadata " + expression + ")");
+}
+
+void DebugInfo::endFunction() {
+    this->subprogram = -1;
+}
+
+void DebugInfo::finish() {
+    auto &buffer = CodeBuffer::instance();
+    int debugInfoVersion = this->addNode("!{i32 2, !\"Debug Info Version\", i32 3}");
+    int dwarfVersion = this->addNode("!{i32 7, !\"Dwarf Version\", i32 4}");
+
+    buffer.emitGlobal("declare void @llvm.dbg.declare(metadata, metadata, metadata)");
+    buffer.emitGlobal("declare void @llvm.dbg.value(metadata, metadata, metadata)");
+    buffer.emitGlobal("!llvm.dbg.cu = !{" + ref(this->unit) + "}");
+    buffer.emitGlobal("!llvm.module.flags = !{" + ref(debugInfoVersion) + ", " + ref(dwarfVersion) + "}");
+    for (size_t i = 0; i < this->nodes.size(); i++) {
+        buffer.emitGlobal(ref(PRELUDE_METADATA_NODES + (int)i) + " = " + this->nodes[i]);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef DEBUG_INFO_H_
+#define DEBUG_INFO_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+
+// DWARF debug info metadata for -g, so debuggers and profilers of the native program can map its code back to FanC
+// functions, lines and variables. Every instruction is given the location of the line it was emitted for. Only
+// metadata and debug intrinsics are added, which optimizations are free to drop
+class DebugInfo {
+    // Metadata nodes, numbered after the prelude's
+    std::vector<std::string> nodes;
+    int file;
+    int unit;
+    std::unordered_map<int, int> basicTypes;
+    // The subprogram of the function being emitted, or -1, and the locations in it by line
+    int subprogram;
+    std::unordered_map<int, int> locations;
+
+    int addNode(const std::string &node);
+    int getBasicType(TypeName type);
+    int addVariable(const std::string &name, TypeName type, int arg);
+
+   public:
+    explicit DebugInfo(const std::string &sourceName);
+    DebugInfo(const DebugInfo &) = delete;
+    void operator=(const DebugInfo &) = delete;
+    // Attachment of the location of the current line to add to command, e.g. ", !dbg !12", or "" if it isn't an
+    // instruction in a function
+    std::string getLocation(const std::string &command);
+    // Start a function. Returns the attachment of its subprogram, to add to its definition
+    std::string startFunction(const std::string &name, TypeName retType, const std::vector<TypeName> &argTypes);
+    // Declare argument number arg (from 1) of the function, whose value is in reg
+    void declareFormal(const std::string &name, TypeName type, int arg, const std::string &reg);
+    // Declare a local at offset in the function's stack variables
+    void declareLocal(const std::string &name, TypeName type, int offset, const std::string &stackVariablesPtrReg);
+    void endFunction();
+    // Emit the metadata, and the declarations of the debug intrinsics
+    void finish();
+};
+
+#endif
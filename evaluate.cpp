@@ -0,0 +1,759 @@
+#include "evaluate.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+#include "bp.hpp"
+#include "irText.hpp"
+#include "ralloc.hpp"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+// Calls nest at most this deep, and the program prints at most MAX_OUTPUT bytes, or they are left to run. Calls are
+// frames on a stack of the interpreter's own, so deep recursion never runs out of the thread's stack
+static const size_t MAX_DEPTH = 5000;
+static const size_t MAX_OUTPUT = 1 << 20;
+static const int NO_OBJECT = -1;
+static const size_t NO_DEFINITION = (size_t)-1;
+
+static bool isBuiltin(const string &name) {
+    return name == "print" or name == "printi" or name == "error_division_by_zero";
+}
+
+Evaluator::Evaluator(int64_t fuel)
+    : fuel(fuel),
+      ranges(),
+      parsed(),
+      scannedCode(0),
+      scannedGlobals(0),
+      openCodeDefinition(NO_DEFINITION),
+      openGlobalDefinition(NO_DEFINITION),
+      stringConstants(),
+      globalObjects(),
+      globals(),
+      stack(),
+      results(),
+      output(),
+      exited(false) {}
+
+// ******** Values ********** //
+
+static uint64_t toUnsigned(int64_t value, int bits) {
+    return bits == 64 ? (uint64_t)value : (uint64_t)value & ((1ULL << bits) - 1);
+}
+
+static int64_t toSigned(int64_t value, int bits) {
+    uint64_t bitsValue = toUnsigned(value, bits);
+    if (bits < 64 and (bitsValue >> (bits - 1))) {
+        return (int64_t)(bitsValue - (1ULL << bits));
+    }
+    return (int64_t)bitsValue;
+}
+
+static string formatConstant(int64_t value, int bits) {
+    if (bits == 1) {
+        return toUnsigned(value, 1) ? "true" : "false";
+    }
+    // Bytes are unsigned in FanC
+    return bits == 8 ? to_string(toUnsigned(value, bits)) : to_string(toSigned(value, bits));
+}
+
+// Size in memory of an integer type or an array of them, or 0 for others
+static int64_t getSize(const string &type) {
+    if (type.size() > 2 and type[0] == '[' and type.back() == ']') {
+        size_t separator = type.find(" x ");
+        if (separator == string::npos) {
+            return 0;
+        }
+        return atoll(type.c_str() + 1) * getSize(type.substr(separator + 3, type.size() - separator - 4));
+    }
+    int bits = getBits(type);
+    return (bits + 7) / 8;
+}
+
+// ******** Parsing ********** //
+
+// Bytes of the contents of a c"..." string constant, unescaped the way LLVM does
+static string unescape(const string &contents) {
+    string bytes;
+    for (size_t i = 0; i < contents.size(); i++) {
+        if (contents[i] == '\\' and i + 1 < contents.size() and contents[i + 1] == '\\') {
+            bytes += '\\';
+            i++;
+        } else if (contents[i] == '\\' and i + 2 < contents.size() and isxdigit((unsigned char)contents[i + 1]) and
+                   isxdigit((unsigned char)contents[i + 2])) {
+            bytes += (char)strtol(contents.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            bytes += contents[i];
+        }
+    }
+    return bytes;
+}
+
+void Evaluator::scanBuffers() {
+    auto &buffer = CodeBuffer::instance();
+    auto scan = [&](bool inGlobals, size_t &scanned, size_t &openDefinition) {
+        size_t size = inGlobals ? buffer.getGlobalSize() : buffer.getCodeSize();
+        // Unrolling a loop that goes around once leaves less code than was already looked through
+        scanned = std::min(scanned, size);
+        for (; scanned < size; scanned++) {
+            const string &line = inGlobals ? buffer.getGlobalLine(scanned) : buffer.getCodeLine(scanned);
+            string body = getBody(line);
+            if (body.compare(0, 7, "define ") == 0) {
+                openDefinition = scanned;
+            } else if (body == "}" and openDefinition != NO_DEFINITION) {
+                const string &definition = inGlobals ? buffer.getGlobalLine(openDefinition) : buffer.getCodeLine(openDefinition);
+                size_t nameStart = definition.find('@') + 1;
+                this->ranges[definition.substr(nameStart, definition.find('(', nameStart) - nameStart)] = {inGlobals, openDefinition, scanned};
+                openDefinition = NO_DEFINITION;
+            } else if (inGlobals and body[0] == '@' and body.find(" constant [") != string::npos) {
+                this->stringConstants[body.substr(1, body.find(' ') - 1)] = scanned;
+            }
+        }
+    };
+    scan(false, this->scannedCode, this->openCodeDefinition);
+    scan(true, this->scannedGlobals, this->openGlobalDefinition);
+}
+
+bool Evaluator::getGlobalObject(const string &name, int &object) {
+    auto found = this->globalObjects.find(name);
+    if (found != this->globalObjects.end()) {
+        object = found->second;
+        return true;
+    }
+    auto constant = this->stringConstants.find(name);
+    if (constant == this->stringConstants.end()) {
+        return false;
+    }
+    const string &line = CodeBuffer::instance().getGlobalLine(constant->second);
+    size_t start = line.find("c\"");
+    size_t end = line.rfind('"');
+    if (start == string::npos or end <= start + 1) {
+        return false;
+    }
+    string bytes = unescape(line.substr(start + 2, end - start - 2));
+    this->globals.emplace_back(bytes.begin(), bytes.end());
+    object = -2 - (int)(this->globals.size() - 1);
+    this->globalObjects[name] = object;
+    return true;
+}
+
+bool Evaluator::parseOperand(const string &text, std::unordered_map<string, int> &slots, Operand &operand) {
+    operand = {false, {0, NO_OBJECT}, -1};
+    if (text.empty()) {
+        return false;
+    }
+    if (text[0] == '%') {
+        operand.isRegister = true;
+        operand.slot = slots.emplace(text, (int)slots.size()).first->second;
+        return true;
+    }
+    if (text[0] == '@') {
+        return this->getGlobalObject(text.substr(1), operand.value.object);
+    }
+    // The address of a string constant, as a constant expression
+    if (text.compare(0, 14, "getelementptr ") == 0) {
+        size_t nameStart = text.find('@');
+        size_t nameEnd = text.find(',', nameStart);
+        if (nameStart == string::npos or nameEnd == string::npos or text.compare(nameEnd, string::npos, ", i32 0, i32 0)") != 0) {
+            return false;
+        }
+        return this->getGlobalObject(text.substr(nameStart + 1, nameEnd - nameStart - 1), operand.value.object);
+    }
+    if (text == "true" or text == "false") {
+        operand.value.bits = text == "true";
+        return true;
+    }
+    size_t digits = text[0] == '-' ? 1 : 0;
+    if (digits == text.size() or text.find_first_not_of("0123456789", digits) != string::npos) {
+        return false;
+    }
+    operand.value.bits = atoll(text.c_str());
+    return true;
+}
+
+bool Evaluator::parseFunction(const Range &range, Function &function) {
+    auto &buffer = CodeBuffer::instance();
+    auto getLine = [&](size_t i) -> const string & { return range.inGlobals ? buffer.getGlobalLine(i) : buffer.getCodeLine(i); };
+    std::unordered_map<string, int> slots;
+    std::unordered_map<string, int> blocks = {{"", 0}};
+    auto getBlock = [&](const string &label) { return blocks.emplace(label, (int)blocks.size()).first->second; };
+    auto parseOperand = [&](const string &text, Operand &operand) { return this->parseOperand(text, slots, operand); };
+    function.code.clear();
+    function.blockStarts = {0};
+
+    // The parameters and return type, from the define line
+    const string &definition = getLine(range.begin);
+    size_t nameStart = definition.find('@');
+    size_t paramsStart = definition.find('(', nameStart);
+    size_t paramsEnd = definition.find(')', paramsStart);
+    vector<string> defineWords = splitInstruction(definition.substr(0, nameStart));
+    function.retBits = defineWords.back() == "void" ? 0 : getBits(defineWords.back());
+    if (function.retBits == 0 and defineWords.back() != "void") {
+        return false;
+    }
+    std::istringstream paramStream(definition.substr(paramsStart + 1, paramsEnd - paramsStart - 1));
+    string param;
+    while (std::getline(paramStream, param, ',')) {
+        vector<string> words = splitInstruction(param);
+        if (words.size() != 2 or words[1][0] != '%') {
+            return false;
+        }
+        function.params.push_back(slots.emplace(words[1], (int)slots.size()).first->second);
+    }
+
+    // Code after a terminator, before the next label, is never reached
+    bool afterTerminator = false;
+    for (size_t address = range.begin + 1; address < range.end; address++) {
+        string body = getBody(getLine(address));
+        if (body.empty() or body[0] == ';') {
+            continue;
+        }
+        if (body.back() == ':') {
+            int block = getBlock(body.substr(0, body.size() - 1));
+            function.blockStarts.resize(std::max(function.blockStarts.size(), (size_t)block + 1), (size_t)-1);
+            function.blockStarts[block] = function.code.size();
+            afterTerminator = false;
+            continue;
+        }
+        if (afterTerminator) {
+            continue;
+        }
+        if (body.find("@llvm.dbg.") != string::npos) {
+            continue;
+        }
+        // Without metadata attachments
+        body = body.substr(0, body.find(", !"));
+
+        Instruction instruction = {Op::NOP, -1, 0, 0, "", {}, {}, {}, ""};
+        vector<string> words = splitInstruction(body);
+        size_t opIndex = 0;
+        if (words.size() > 2 and words[1] == "=") {
+            instruction.result = slots.emplace(words[0], (int)slots.size()).first->second;
+            opIndex = 2;
+        }
+        const string &op = words[opIndex];
+        auto operandsFrom = [&](size_t first) {
+            for (size_t i = first; i < words.size(); i++) {
+                instruction.operands.emplace_back();
+                if (not parseOperand(words[i], instruction.operands.back())) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        if (op == "add" or op == "sub" or op == "mul" or op == "sdiv" or op == "udiv" or op == "and" or op == "or" or op == "xor") {
+            instruction.op = Op::BINARY;
+            instruction.name = op;
+            instruction.bits = words.size() == 6 ? getBits(words[3]) : 0;
+            if (instruction.bits == 0 or not operandsFrom(4)) {
+                return false;
+            }
+        } else if (op == "icmp" and words.size() == 7) {
+            instruction.op = Op::ICMP;
+            instruction.name = words[3];
+            instruction.bits = getBits(words[4]);
+            if (instruction.bits == 0 or not operandsFrom(5)) {
+                return false;
+            }
+        } else if ((op == "zext" or op == "sext" or op == "trunc") and words.size() == 7) {
+            instruction.op = Op::CAST;
+            instruction.name = op;
+            instruction.fromBits = getBits(words[3]);
+            instruction.bits = getBits(words[6]);
+            instruction.operands.emplace_back();
+            if (instruction.fromBits == 0 or instruction.bits == 0 or not parseOperand(words[4], instruction.operands[0])) {
+                return false;
+            }
+        } else if (op == "bitcast" and words.size() == 7) {
+            instruction.op = Op::POINTER_CAST;
+            instruction.operands.emplace_back();
+            if (not parseOperand(words[4], instruction.operands[0])) {
+                return false;
+            }
+        } else if (op == "alloca" and (words.size() == 4 or words.size() == 6)) {
+            instruction.op = Op::ALLOCA;
+            int64_t size = getSize(words[3]) * (words.size() == 6 ? atoll(words[5].c_str()) : 1);
+            if (size <= 0) {
+                return false;
+            }
+            instruction.sizes.push_back(size);
+        } else if (op == "getelementptr") {
+            // The element type, the pointer and the indices
+            instruction.op = Op::GEP;
+            vector<string> segments;
+            string rest = body.substr(body.find(op) + op.size() + 1);
+            for (size_t start = 0, end; start <= rest.size(); start = end + 2) {
+                end = std::min(rest.find(", ", start), rest.size());
+                segments.push_back(rest.substr(start, end - start));
+            }
+            if (segments.size() < 3 or segments.size() > 4) {
+                return false;
+            }
+            string elementType = segments[0];
+            instruction.operands.emplace_back();
+            if (not parseOperand(segments[1].substr(segments[1].rfind(' ') + 1), instruction.operands[0])) {
+                return false;
+            }
+            for (size_t i = 2; i < segments.size(); i++) {
+                int64_t size = getSize(elementType);
+                if (size <= 0) {
+                    return false;
+                }
+                instruction.sizes.push_back(size);
+                instruction.operands.emplace_back();
+                if (not parseOperand(segments[i].substr(segments[i].rfind(' ') + 1), instruction.operands.back())) {
+                    return false;
+                }
+                // Further indices are into the array's elements
+                if (elementType[0] == '[') {
+                    elementType = elementType.substr(elementType.find(" x ") + 3);
+                    elementType.pop_back();
+                }
+            }
+        } else if (op == "load" and words.size() == 6) {
+            instruction.op = Op::LOAD;
+            instruction.bits = getBits(words[3]);
+            instruction.operands.emplace_back();
+            if (getSize(words[3]) == 0 or not parseOperand(words[5], instruction.operands[0])) {
+                return false;
+            }
+        } else if (op == "store" and words.size() == 5) {
+            instruction.op = Op::STORE;
+            instruction.bits = getBits(words[1]);
+            // The value and the pointer
+            instruction.operands.resize(2);
+            if (getSize(words[1]) == 0 or not parseOperand(words[2], instruction.operands[0]) or
+                not parseOperand(words[4], instruction.operands[1])) {
+                return false;
+            }
+        } else if (op == "phi") {
+            instruction.op = Op::PHI;
+            for (size_t open = body.find('['); open != string::npos; open = body.find('[', open + 1)) {
+                size_t close = body.find(']', open);
+                vector<string> entry = splitInstruction(body.substr(open + 1, close - open - 1));
+                instruction.operands.emplace_back();
+                if (entry.size() != 2 or entry[1][0] != '%' or not parseOperand(entry[0], instruction.operands.back())) {
+                    return false;
+                }
+                instruction.blocks.push_back(getBlock(entry[1].substr(1)));
+            }
+        } else if (op == "br" and words.size() == 3) {
+            instruction.op = Op::BR;
+            instruction.blocks.push_back(getBlock(words[2].substr(1)));
+        } else if (op == "br" and words.size() == 7 and words[1] == "i1") {
+            instruction.op = Op::COND_BR;
+            instruction.operands.emplace_back();
+            if (not parseOperand(words[2], instruction.operands[0])) {
+                return false;
+            }
+            instruction.blocks.push_back(getBlock(words[4].substr(1)));
+            instruction.blocks.push_back(getBlock(words[6].substr(1)));
+        } else if (op == "ret") {
+            instruction.op = Op::RET;
+            if (words.size() == 3 and not operandsFrom(2)) {
+                return false;
+            }
+        } else if (op == "unreachable") {
+            instruction.op = Op::UNREACHABLE;
+        } else if (op == "call") {
+            instruction.op = Op::CALL;
+            size_t calleeStart = body.find('@');
+            size_t argsStart = body.find('(', calleeStart);
+            size_t argsEnd = body.rfind(')');
+            if (calleeStart == string::npos or argsStart == string::npos or argsEnd < argsStart) {
+                return false;
+            }
+            instruction.callee = body.substr(calleeStart + 1, argsStart - calleeStart - 1);
+            // Each argument is a type and an operand, which may be a constant expression with commas of its own
+            int depth = 0;
+            size_t argStart = argsStart + 1;
+            for (size_t i = argStart; i <= argsEnd; i++) {
+                if (body[i] == '(' or body[i] == '[') {
+                    depth++;
+                } else if ((body[i] == ')' or body[i] == ']') and i < argsEnd) {
+                    depth--;
+                } else if ((body[i] == ',' and depth == 0) or i == argsEnd) {
+                    string arg = body.substr(argStart, i - argStart);
+                    argStart = i + 1;
+                    size_t typeStart = arg.find_first_not_of(' ');
+                    if (typeStart == string::npos) {
+                        continue;
+                    }
+                    size_t operandStart = arg.find(' ', typeStart);
+                    instruction.operands.emplace_back();
+                    if (operandStart == string::npos or not parseOperand(arg.substr(operandStart + 1), instruction.operands.back())) {
+                        return false;
+                    }
+                }
+            }
+        } else {
+            return false;
+        }
+        if (instruction.op == Op::BR or instruction.op == Op::COND_BR or instruction.op == Op::RET or instruction.op == Op::UNREACHABLE) {
+            afterTerminator = true;
+        }
+        function.code.push_back(instruction);
+    }
+
+    // Every block branched to was found
+    function.blockStarts.resize(blocks.size(), (size_t)-1);
+    for (size_t start : function.blockStarts) {
+        if (start == (size_t)-1) {
+            return false;
+        }
+    }
+    function.slotCount = slots.size();
+    return true;
+}
+
+const Evaluator::Function *Evaluator::getFunction(const string &name) {
+    auto found = this->parsed.find(name);
+    if (found == this->parsed.end()) {
+        auto range = this->ranges.find(name);
+        if (range == this->ranges.end()) {
+            return nullptr;
+        }
+        found = this->parsed.emplace(name, Function()).first;
+        found->second.ok = this->parseFunction(range->second, found->second);
+    }
+    return found->second.ok ? &found->second : nullptr;
+}
+
+// ******** Running ********** //
+
+vector<uint8_t> *Evaluator::getObject(const Value &pointer, int64_t size) {
+    vector<uint8_t> *object;
+    if (pointer.object >= 0 and (size_t)pointer.object < this->stack.size()) {
+        object = &this->stack[pointer.object];
+    } else if (pointer.object <= -2 and (size_t)(-2 - pointer.object) < this->globals.size()) {
+        object = &this->globals[-2 - pointer.object];
+    } else {
+        return nullptr;
+    }
+    return pointer.bits >= 0 and pointer.bits + size <= (int64_t)object->size() ? object : nullptr;
+}
+
+bool Evaluator::callBuiltin(const string &name, const vector<Value> &args) {
+    if (name == "printi") {
+        this->output += to_string(toSigned(args[0].bits, 32)) + "\n";
+    } else if (name == "print") {
+        vector<uint8_t> *object = this->getObject(args[0], 1);
+        if (not object) {
+            return false;
+        }
+        for (size_t i = args[0].bits; i < object->size() and (*object)[i]; i++) {
+            this->output += (char)(*object)[i];
+        }
+        this->output += "\n";
+    } else {
+        this->output += "Error division by zero\n";
+        this->exited = true;
+        return false;
+    }
+    return this->output.size() <= MAX_OUTPUT;
+}
+
+bool Evaluator::pushFrame(vector<Frame> &frames, const string &name, const vector<Value> &args, int resultSlot) {
+    const Function *function = this->getFunction(name);
+    if (not function or frames.size() >= MAX_DEPTH or args.size() != function->params.size()) {
+        return false;
+    }
+    frames.push_back({function, vector<Value>(function->slotCount, Value{0, NO_OBJECT}), 0, -1, 0, this->stack.size(), resultSlot});
+    for (size_t i = 0; i < args.size(); i++) {
+        frames.back().registers[function->params[i]] = args[i];
+    }
+    return true;
+}
+
+bool Evaluator::call(const string &name, const vector<Value> &args, Value &result) {
+    if (isBuiltin(name)) {
+        result = {0, NO_OBJECT};
+        return this->callBuiltin(name, args);
+    }
+    size_t stackSize = this->stack.size();
+    vector<Frame> frames;
+    bool ran = this->pushFrame(frames, name, args, -1) and this->run(frames, result);
+    this->stack.resize(stackSize);
+    return ran;
+}
+
+bool Evaluator::run(vector<Frame> &frames, Value &result) {
+    while (not frames.empty()) {
+        Frame &frame = frames.back();
+        const Function &function = *frame.function;
+        auto get = [&frame](const Operand &operand) { return operand.isRegister ? frame.registers[operand.slot] : operand.value; };
+        auto branch = [&frame, &function](int target) {
+            frame.previousBlock = frame.block;
+            frame.block = target;
+            frame.pc = function.blockStarts[target];
+        };
+
+        if (frame.pc >= function.code.size()) {
+            return false;
+        }
+        if (this->fuel <= 0) {
+            return false;
+        }
+        this->fuel--;
+        const Instruction &instruction = function.code[frame.pc++];
+        Value value = {0, NO_OBJECT};
+        switch (instruction.op) {
+            case Op::BINARY: {
+                int bits = instruction.bits;
+                Value a = get(instruction.operands[0]), b = get(instruction.operands[1]);
+                const string &op = instruction.name;
+                if (op == "add") {
+                    value.bits = a.bits + b.bits;
+                } else if (op == "sub") {
+                    value.bits = a.bits - b.bits;
+                } else if (op == "mul") {
+                    value.bits = (int64_t)(toUnsigned(a.bits, bits) * toUnsigned(b.bits, bits));
+                } else if (op == "and") {
+                    value.bits = a.bits & b.bits;
+                } else if (op == "or") {
+                    value.bits = a.bits | b.bits;
+                } else if (op == "xor") {
+                    value.bits = a.bits ^ b.bits;
+                } else if (op == "sdiv") {
+                    int64_t sa = toSigned(a.bits, bits), sb = toSigned(b.bits, bits);
+                    // Division by zero and overflow are left to the target
+                    if (sb == 0 or (sb == -1 and sa == toSigned(1LL << (bits - 1), bits))) {
+                        return false;
+                    }
+                    value.bits = sa / sb;
+                } else {
+                    uint64_t ub = toUnsigned(b.bits, bits);
+                    if (ub == 0) {
+                        return false;
+                    }
+                    value.bits = (int64_t)(toUnsigned(a.bits, bits) / ub);
+                }
+                value.bits = (int64_t)toUnsigned(value.bits, bits);
+                break;
+            }
+            case Op::ICMP: {
+                int bits = instruction.bits;
+                Value a = get(instruction.operands[0]), b = get(instruction.operands[1]);
+                int64_t sa = toSigned(a.bits, bits), sb = toSigned(b.bits, bits);
+                uint64_t ua = toUnsigned(a.bits, bits), ub = toUnsigned(b.bits, bits);
+                const string &predicate = instruction.name;
+                if (predicate == "eq") {
+                    value.bits = ua == ub;
+                } else if (predicate == "ne") {
+                    value.bits = ua != ub;
+                } else if (predicate == "sgt") {
+                    value.bits = sa > sb;
+                } else if (predicate == "sge") {
+                    value.bits = sa >= sb;
+                } else if (predicate == "slt") {
+                    value.bits = sa < sb;
+                } else if (predicate == "sle") {
+                    value.bits = sa <= sb;
+                } else if (predicate == "ugt") {
+                    value.bits = ua > ub;
+                } else if (predicate == "uge") {
+                    value.bits = ua >= ub;
+                } else if (predicate == "ult") {
+                    value.bits = ua < ub;
+                } else if (predicate == "ule") {
+                    value.bits = ua <= ub;
+                } else {
+                    return false;
+                }
+                break;
+            }
+            case Op::CAST: {
+                int64_t operand = get(instruction.operands[0]).bits;
+                operand = instruction.name == "sext" ? toSigned(operand, instruction.fromBits) : (int64_t)toUnsigned(operand, instruction.fromBits);
+                value.bits = (int64_t)toUnsigned(operand, instruction.bits);
+                break;
+            }
+            case Op::POINTER_CAST:
+                value = get(instruction.operands[0]);
+                break;
+            case Op::ALLOCA:
+                this->stack.emplace_back(instruction.sizes[0], 0);
+                value.object = this->stack.size() - 1;
+                break;
+            case Op::GEP:
+                value = get(instruction.operands[0]);
+                for (size_t i = 1; i < instruction.operands.size(); i++) {
+                    value.bits += toSigned(get(instruction.operands[i]).bits, 32) * instruction.sizes[i - 1];
+                }
+                break;
+            case Op::LOAD: {
+                Value pointer = get(instruction.operands[0]);
+                int64_t size = (instruction.bits + 7) / 8;
+                vector<uint8_t> *object = this->getObject(pointer, size);
+                if (not object) {
+                    return false;
+                }
+                uint64_t loaded = 0;
+                for (int64_t i = size - 1; i >= 0; i--) {
+                    loaded = loaded << 8 | (*object)[pointer.bits + i];
+                }
+                value.bits = (int64_t)toUnsigned(loaded, instruction.bits);
+                break;
+            }
+            case Op::STORE: {
+                Value stored = get(instruction.operands[0]);
+                Value pointer = get(instruction.operands[1]);
+                int64_t size = (instruction.bits + 7) / 8;
+                // Globals are constants
+                vector<uint8_t> *object = pointer.object >= 0 ? this->getObject(pointer, size) : nullptr;
+                if (not object or stored.object != NO_OBJECT) {
+                    return false;
+                }
+                for (int64_t i = 0; i < size; i++) {
+                    (*object)[pointer.bits + i] = (uint8_t)((uint64_t)stored.bits >> (8 * i));
+                }
+                break;
+            }
+            case Op::PHI: {
+                size_t i = 0;
+                while (i < instruction.blocks.size() and instruction.blocks[i] != frame.previousBlock) {
+                    i++;
+                }
+                if (i == instruction.blocks.size()) {
+                    return false;
+                }
+                value = get(instruction.operands[i]);
+                break;
+            }
+            case Op::BR:
+                branch(instruction.blocks[0]);
+                break;
+            case Op::COND_BR:
+                branch(instruction.blocks[toUnsigned(get(instruction.operands[0]).bits, 1) ? 0 : 1]);
+                break;
+            case Op::RET: {
+                // The callee's stack objects go with it
+                Value returned = instruction.operands.empty() ? Value{0, NO_OBJECT} : get(instruction.operands[0]);
+                int resultSlot = frame.resultSlot;
+                this->stack.resize(frame.stackSize);
+                frames.pop_back();
+                if (frames.empty()) {
+                    result = returned;
+                    return true;
+                }
+                if (resultSlot >= 0) {
+                    frames.back().registers[resultSlot] = returned;
+                }
+                continue;
+            }
+            case Op::CALL: {
+                vector<Value> callArgs;
+                for (auto &operand : instruction.operands) {
+                    callArgs.push_back(get(operand));
+                }
+                if (not isBuiltin(instruction.callee)) {
+                    // Runs from the next iteration, and its ret resumes this frame
+                    if (not this->pushFrame(frames, instruction.callee, callArgs, instruction.result)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (not this->callBuiltin(instruction.callee, callArgs)) {
+                    return false;
+                }
+                break;
+            }
+            case Op::UNREACHABLE:
+                return false;
+            case Op::NOP:
+                break;
+        }
+        if (instruction.result >= 0) {
+            frame.registers[instruction.result] = value;
+        }
+    }
+    return false;
+}
+
+// ******** Hooks ********** //
+
+bool Evaluator::evaluateCall(const string &name, const vector<string> &args, string &result) {
+    string key = name + "(";
+    for (auto &arg : args) {
+        key += arg + ",";
+    }
+    auto found = this->results.find(key);
+    if (found != this->results.end()) {
+        result = found->second;
+        return true;
+    }
+    if (this->fuel <= 0) {
+        return false;
+    }
+
+    this->scanBuffers();
+    std::unordered_map<string, int> noSlots;
+    vector<Value> values;
+    for (auto &arg : args) {
+        Operand operand;
+        if (not this->parseOperand(arg.substr(arg.find(' ') + 1), noSlots, operand) or operand.isRegister) {
+            return false;
+        }
+        values.push_back(operand.value);
+    }
+    const Function *function = this->getFunction(name);
+    Value value;
+    bool evaluated = function and this->call(name, values, value) and this->output.empty();
+    this->output.clear();
+    this->exited = false;
+    if (not evaluated or value.object != NO_OBJECT) {
+        return false;
+    }
+    result = function->retBits == 0 ? "" : formatConstant(value.bits, function->retBits);
+    this->results[key] = result;
+    return true;
+}
+
+void Evaluator::evaluateProgram() {
+    this->scanBuffers();
+    auto main = this->ranges.find("main");
+    if (main == this->ranges.end() or main->second.inGlobals or this->fuel <= 0) {
+        return;
+    }
+    Value value;
+    bool evaluated = this->call("main", {}, value) or this->exited;
+    if (not evaluated) {
+        return;
+    }
+
+    // main just prints the output, without the newline print adds
+    auto &buffer = CodeBuffer::instance();
+    auto &ralloc = Ralloc::instance();
+    vector<string> body;
+    if (not this->output.empty()) {
+        string text = this->output.substr(0, this->output.size() - 1);
+        string escaped;
+        for (unsigned char c : text) {
+            if (c < ' ' or c > '~' or c == '"' or c == '\\') {
+                const char *digits = "0123456789ABCDEF";
+                escaped += string("\\") + digits[c >> 4] + digits[c & 15];
+            } else {
+                escaped += (char)c;
+            }
+        }
+        string arrayType = "[" + to_string(text.size() + 1) + " x i8]";
+        string outputReg = ralloc.getNextReg("evaluatedOutput");
+        buffer.emitGlobal("@.evaluated_output = constant " + arrayType + " c\"" + escaped + "\\00\"");
+        body.push_back("\t" + outputReg + " = getelementptr " + arrayType + ", " + arrayType + "* @.evaluated_output, i32 0, i32 0");
+        body.push_back("\tcall void @print(i8* " + outputReg + ")");
+    }
+    if (this->exited) {
+        body.push_back("\tcall void @exit(i32 0)");
+        body.push_back("\tunreachable");
+    } else {
+        body.push_back("\tret void");
+    }
+    buffer.replaceCode(main->second.begin + 1, main->second.end, body);
+}
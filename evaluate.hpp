@@ -0,0 +1,121 @@
+#ifndef EVALUATE_H_
+#define EVALUATE_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compile time evaluation for --evaluate. FanC programs have no input, so whatever they compute is known at compile
+// time. The evaluator interprets the IR of functions that were already lowered, so a call to a function that doesn't
+// print with literal arguments is replaced by its result, and once the whole program is lowered, main is replaced by
+// printing what it would print. Every instruction interpreted burns one unit of fuel out of a budget for the whole
+// compilation. Anything the interpreter doesn't know, like the tables of --memoize, or running out of fuel, falls back
+// to the lowered code
+class Evaluator {
+    struct Value {
+        // The integer, or the offset into object
+        int64_t bits;
+        // Memory object a pointer points into: a stack object from 0 up, a global object from -2 down, or NO_OBJECT
+        int object;
+    };
+
+    // A constant (or the pointer to a global) or a register slot
+    struct Operand {
+        bool isRegister;
+        Value value;
+        int slot;
+    };
+
+    enum class Op { BINARY, ICMP, CAST, POINTER_CAST, ALLOCA, GEP, LOAD, STORE, PHI, BR, COND_BR, RET, CALL, UNREACHABLE, NOP };
+
+    struct Instruction {
+        Op op;
+        // Register slot of the result, or -1
+        int result;
+        // Width of the operation's type, and of the type converted from by casts
+        int bits;
+        int fromBits;
+        // Operator of binary operations and icmp
+        std::string name;
+        std::vector<Operand> operands;
+        // Byte size of each index of a GEP, or the block ids of branch targets and phi incoming values
+        std::vector<int64_t> sizes;
+        std::vector<int> blocks;
+        std::string callee;
+    };
+
+    struct Function {
+        std::vector<Instruction> code;
+        // Where each block starts in code, by block id. The entry block is 0
+        std::vector<size_t> blockStarts;
+        int slotCount;
+        // Slots of the parameters
+        std::vector<int> params;
+        int retBits;
+        bool ok;
+    };
+
+    // A call being evaluated
+    struct Frame {
+        const Function *function;
+        std::vector<Value> registers;
+        int block;
+        int previousBlock;
+        size_t pc;
+        // Size of stack when the call started, which its ret drops back to
+        size_t stackSize;
+        // Register slot of the caller the result goes to, or -1
+        int resultSlot;
+    };
+
+    // Code buffer range of each lowered function, from its define line to its closing brace, by name
+    struct Range {
+        bool inGlobals;
+        size_t begin;
+        size_t end;
+    };
+
+    int64_t fuel;
+    std::unordered_map<std::string, Range> ranges;
+    std::unordered_map<std::string, Function> parsed;
+    // How far the code and global buffers were looked through for functions and string constants
+    size_t scannedCode;
+    size_t scannedGlobals;
+    // Start of the function being defined in each buffer, if its closing brace wasn't reached yet
+    size_t openCodeDefinition;
+    size_t openGlobalDefinition;
+    // Global line of each string constant, and the object it was loaded into once used
+    std::unordered_map<std::string, size_t> stringConstants;
+    std::unordered_map<std::string, int> globalObjects;
+    std::vector<std::vector<uint8_t>> globals;
+    // The objects allocated by the calls being evaluated
+    std::vector<std::vector<uint8_t>> stack;
+    // Results of the calls evaluated so far, by callee and arguments
+    std::unordered_map<std::string, std::string> results;
+    std::string output;
+    bool exited;
+
+    void scanBuffers();
+    const Function *getFunction(const std::string &name);
+    bool parseFunction(const Range &range, Function &function);
+    bool parseOperand(const std::string &text, std::unordered_map<std::string, int> &slots, Operand &operand);
+    bool getGlobalObject(const std::string &name, int &object);
+    std::vector<uint8_t> *getObject(const Value &pointer, int64_t size);
+    bool callBuiltin(const std::string &name, const std::vector<Value> &args);
+    bool pushFrame(std::vector<Frame> &frames, const std::string &name, const std::vector<Value> &args, int resultSlot);
+    bool call(const std::string &name, const std::vector<Value> &args, Value &result);
+    bool run(std::vector<Frame> &frames, Value &result);
+
+   public:
+    explicit Evaluator(int64_t fuel);
+    Evaluator(const Evaluator &) = delete;
+    void operator=(const Evaluator &) = delete;
+    // Evaluate the call of the function name with args (each "type value", literals only) that doesn't print, and
+    // put its result, formatted as a literal, in result ("" for void). Returns false if it couldn't be evaluated
+    bool evaluateCall(const std::string &name, const std::vector<std::string> &args, std::string &result);
+    // Once the program is lowered, replace the body of main by printing its output, if it can be evaluated
+    void evaluateProgram();
+};
+
+#endif
@@ -0,0 +1,531 @@
+#include "funcCache.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unordered_set>
+
+#include "compilation.hpp"
+#include "hw3_output.hpp"
+#include "irText.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+typedef yy::parser::token token;
+
+// The version of the file format and of the IR functions are lowered to. Bump it whenever either changes, as cached IR
+// is only valid for the lowering that produced it. Caches of other versions are ignored
+static const char CACHE_MAGIC[] = "hw5 function cache 6";
+
+// Two 64 bit FNV-1a style hashes with different primes, together wide enough that keys never collide in practice
+class KeyHasher {
+    uint64_t high = 0x6c62272e07bb0142;
+    uint64_t low = 0xcbf29ce484222325;
+
+   public:
+    void add(const void *data, size_t size) {
+        auto bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++) {
+            this->low = (this->low ^ bytes[i]) * 0x100000001b3;
+            this->high = (this->high ^ bytes[i]) * 0x9e3779b97f4a7c15;
+            this->high ^= this->high >> 29;
+        }
+    }
+
+    void add(int value) {
+        this->add(&value, sizeof(value));
+    }
+
+    // Strings are prefixed with their length, so consecutive strings can't run into each other
+    void add(string_view text) {
+        this->add((int)text.size());
+        this->add(text.data(), text.size());
+    }
+
+    FunctionCache::Key getKey() const {
+        return {this->high, this->low};
+    }
+};
+
+bool FunctionCache::Key::operator==(const Key &other) const {
+    return this->high == other.high and this->low == other.low;
+}
+
+size_t FunctionCache::KeyHash::operator()(const Key &key) const {
+    return key.low;
+}
+
+FunctionCache::FunctionCache(const string &path)
+    : path(path), entries(), functions(), currentFunction(0), hitCount(0) {}
+
+string FunctionCache::getCachePath(const string &directory, const string &sourceName) {
+    KeyHasher hasher;
+    hasher.add(string_view(sourceName));
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.fcache", (unsigned long long)hasher.getKey().low);
+    return directory + "/" + name;
+}
+
+// ******** Cache file ********** //
+// The file is CACHE_MAGIC followed by the entries. Numbers are in the machine's byte order, since the file is only
+// ever read by the build that wrote it
+
+class CacheReader {
+    const char *next;
+    const char *end;
+
+   public:
+    bool ok = true;
+
+    CacheReader(const char *data, size_t size) : next(data), end(data + size) {}
+
+    void read(void *data, size_t size) {
+        if (not this->ok or (size_t)(this->end - this->next) < size) {
+            this->ok = false;
+            memset(data, 0, size);
+            return;
+        }
+        memcpy(data, this->next, size);
+        this->next += size;
+    }
+
+    template <typename T>
+    T read() {
+        T value;
+        this->read(&value, sizeof(value));
+        return value;
+    }
+
+    string_view readString() {
+        auto size = this->read<uint32_t>();
+        if (not this->ok or (size_t)(this->end - this->next) < size) {
+            this->ok = false;
+            return string_view();
+        }
+        string_view text(this->next, size);
+        this->next += size;
+        return text;
+    }
+
+    bool atEnd() const {
+        return this->next == this->end;
+    }
+};
+
+class CacheWriter {
+    string data;
+
+   public:
+    void write(const void *value, size_t size) {
+        this->data.append((const char *)value, size);
+    }
+
+    template <typename T>
+    void write(T value) {
+        this->write(&value, sizeof(value));
+    }
+
+    void writeString(string_view text) {
+        this->write((uint32_t)text.size());
+        this->data += text;
+    }
+
+    // Write lines as one string of newline terminated lines
+    template <typename GetLine>
+    void writeLines(size_t begin, size_t end, GetLine getLine) {
+        size_t size = 0;
+        for (size_t i = begin; i < end; i++) {
+            size += getLine(i).size() + 1;
+        }
+        this->write((uint32_t)size);
+        for (size_t i = begin; i < end; i++) {
+            this->data += getLine(i);
+            this->data += '\n';
+        }
+    }
+
+    const string &getData() const {
+        return this->data;
+    }
+};
+
+void FunctionCache::load() {
+    if (not this->file.open(this->path.c_str())) {
+        return;
+    }
+
+    CacheReader reader(this->file.getSource(), this->file.getSourceSize());
+    if (reader.readString() != CACHE_MAGIC) {
+        return;
+    }
+
+    auto count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < count and reader.ok; i++) {
+        Key key;
+        Entry entry;
+        key.high = reader.read<uint64_t>();
+        key.low = reader.read<uint64_t>();
+        entry.retType = (TypeName)reader.read<uint8_t>();
+        entry.argTypes.resize(reader.read<uint32_t>());
+        for (size_t j = 0; j < entry.argTypes.size() and reader.ok; j++) {
+            entry.argTypes[j] = (TypeName)reader.read<uint8_t>();
+        }
+        entry.firstRegNumber = reader.read<int32_t>();
+        entry.regCount = reader.read<int32_t>();
+        entry.firstCodeLocation = reader.read<uint64_t>();
+        entry.firstLine = reader.read<int32_t>();
+        entry.effects = reader.read<uint8_t>();
+        entry.code = reader.readString();
+        entry.globals = reader.readString();
+        this->entries.emplace(key, std::move(entry));
+    }
+
+    // A truncated or otherwise broken file is thrown away as a whole
+    if (not reader.ok or not reader.atEnd()) {
+        this->entries.clear();
+    }
+}
+
+bool FunctionCache::save() const {
+    // Functions after a compile error were neither lowered nor spliced, and there is nothing to save for them. If
+    // every function came from the cache and nothing in it went stale, the file is already up to date
+    if (this->currentFunction != this->functions.size() or
+        ((size_t)this->hitCount == this->functions.size() and this->entries.size() == this->functions.size())) {
+        return true;
+    }
+
+    auto &compilation = Compilation::current();
+    const CodeBuffer &buffer = compilation.codeBuffer;
+    CacheWriter writer;
+    writer.writeString(CACHE_MAGIC);
+    writer.write((uint32_t)this->functions.size());
+
+    for (auto &function : this->functions) {
+        auto funcId = compilation.symbolTable.getFuncSymbol(function.name, false);
+        writer.write(function.key.high);
+        writer.write(function.key.low);
+        writer.write((uint8_t)funcId->getType());
+        writer.write((uint32_t)funcId->getArgTypes().size());
+        for (TypeName argType : funcId->getArgTypes()) {
+            writer.write((uint8_t)argType);
+        }
+        writer.write((int32_t)function.firstRegNumber);
+        writer.write((int32_t)function.regCount);
+        writer.write((uint64_t)function.firstCodeLocation);
+        writer.write((int32_t)function.firstLine);
+        writer.write((uint8_t)funcId->getEffects());
+        writer.writeLines(function.firstCodeLocation, function.codeEnd,
+                          [&buffer](size_t i) -> const string & { return buffer.getCodeLine(i); });
+        writer.writeLines(function.firstGlobal, function.globalEnd,
+                          [&buffer](size_t i) -> const string & { return buffer.getGlobalLine(i); });
+    }
+
+    // Write a temporary file and rename it over the old one, so a concurrent compile never reads a partial file
+    string directory = this->path.substr(0, this->path.find_last_of('/'));
+    if (mkdir(directory.c_str(), 0777) != 0 and errno != EEXIST) {
+        return false;
+    }
+
+    string temporaryPath = this->path + ".XXXXXX";
+    int fd = mkstemp(&temporaryPath[0]);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok;
+    {
+        OutputWriter out(fd);
+        out.write(writer.getData());
+        ok = out.flush();
+    }
+    if (close(fd) != 0) {
+        ok = false;
+    }
+    if (not ok or rename(temporaryPath.c_str(), this->path.c_str()) != 0) {
+        int savedErrno = errno;
+        unlink(temporaryPath.c_str());
+        errno = savedErrno;
+        return false;
+    }
+    return true;
+}
+
+// ******** Finding functions ********** //
+
+// Index just past the RBRACE that closes the function starting at start, or 0 if the function is cut short by the end
+// of the source or a lexical error
+static size_t findFunctionEnd(const vector<Token> &tokens, size_t start) {
+    int depth = 0;
+    for (size_t i = start; i < tokens.size(); i++) {
+        switch (tokens[i].kind) {
+            case token::LBRACE:
+                depth++;
+                break;
+            case token::RBRACE:
+                if (depth > 0 and --depth == 0) {
+                    return i + 1;
+                }
+                break;
+            case token::YYEOF:
+            case TokenStream::LEX_ERROR:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+void FunctionCache::prepare(vector<Token> &tokens) {
+    auto &interner = Compilation::current().interner;
+    // Signatures of the functions defined so far, as the kinds of the tokens in their header other than names, followed
+    // by their keys
+    std::unordered_map<SymbolId, string> signatures;
+    vector<Token> prepared;
+    prepared.reserve(tokens.size());
+
+    size_t start = 0;
+    size_t end;
+    while ((end = findFunctionEnd(tokens, start)) != 0) {
+        const int firstLine = tokens[start].lineno;
+        KeyHasher hasher;
+        std::unordered_set<SymbolId> boundIds;
+        string signature;
+        bool inHeader = true;
+
+        for (size_t i = start; i < end; i++) {
+            const Token &current = tokens[i];
+            hasher.add(current.kind);
+            hasher.add(current.lineno - firstLine);
+
+            if (current.kind == token::LBRACE) {
+                inHeader = false;
+            } else if (inHeader and current.kind != token::ID) {
+                signature += (char)current.kind;
+            }
+
+            if (current.kind == token::ID) {
+                hasher.add(string_view(interner.getName(current.id)));
+                // The function depends on what each name meant before it, i.e. on the signature of a function by
+                // that name if there was one
+                if (boundIds.insert(current.id).second) {
+                    auto binding = signatures.find(current.id);
+                    hasher.add(string_view(binding == signatures.end() ? "-" : binding->second));
+                }
+            } else if (current.kind == token::NUM or current.kind == token::STRING) {
+                hasher.add(current.text);
+            }
+        }
+        // The parser may look at the next token before it finishes the function, and emit with that token's line
+        hasher.add(tokens[end].lineno - firstLine);
+
+        Function function = {};
+        function.key = hasher.getKey();
+        function.name = tokens[start + 1].kind == token::ID ? tokens[start + 1].id : -1;
+        function.firstLine = firstLine;
+        auto entry = this->entries.find(function.key);
+        function.cached = entry == this->entries.end() ? nullptr : &entry->second;
+
+        if (function.cached) {
+            prepared.push_back({token::CACHED_FUNC, firstLine, -1, string_view()});
+        } else {
+            prepared.insert(prepared.end(), tokens.begin() + start, tokens.begin() + end);
+        }
+        // The attributes of a caller are inferred from what its callees do, so it depends on their code too
+        signatures.emplace(function.name, signature + string((const char *)&function.key, sizeof(function.key)));
+        this->functions.push_back(function);
+        start = end;
+    }
+
+    prepared.insert(prepared.end(), tokens.begin() + start, tokens.end());
+    tokens.swap(prepared);
+}
+
+// ******** Lowering and splicing ********** //
+
+void FunctionCache::startFunction() {
+    // The parser can only get past the functions found in the tokens on a source that won't compile anyway
+    if (this->currentFunction >= this->functions.size()) {
+        return;
+    }
+    auto &compilation = Compilation::current();
+    Function &function = this->functions[this->currentFunction];
+    function.firstRegNumber = compilation.ralloc.peekNextNumber();
+    function.firstCodeLocation = compilation.codeBuffer.getCodeSize();
+    function.firstGlobal = compilation.codeBuffer.getGlobalSize();
+}
+
+void FunctionCache::endFunction() {
+    if (this->currentFunction >= this->functions.size()) {
+        return;
+    }
+    auto &compilation = Compilation::current();
+    Function &function = this->functions[this->currentFunction];
+    function.regCount = compilation.ralloc.peekNextNumber() - function.firstRegNumber;
+    function.codeEnd = compilation.codeBuffer.getCodeSize();
+    function.globalEnd = compilation.codeBuffer.getGlobalSize();
+    this->currentFunction++;
+}
+
+// Length of the name (with its sigil, if it has one) starting at start
+static size_t getNameLength(string_view line, size_t start) {
+    size_t end = start + 1;
+    while (end < line.size() and isNameChar(line[end])) {
+        end++;
+    }
+    return end - start;
+}
+
+// Call handleLine on each line of newline terminated lines
+template <typename HandleLine>
+static void forEachLine(string_view lines, HandleLine handleLine) {
+    for (size_t start = 0, end; start < lines.size(); start = end + 1) {
+        end = lines.find('\n', start);
+        handleLine(lines.substr(start, end - start));
+    }
+}
+
+// How the names in a cached function move to its place in this compilation. Every register in the function's range of
+// numbers was allocated by it. Labels are numbered by their location in the code buffer, and are told apart from
+// registers by name. Globals, string constants included, are named after what they are and keep their names
+struct Renumbering {
+    long firstRegNumber;
+    long regCount;
+    long regDelta;
+    long labelDelta;
+    // Labels defined in the function, without the sigil
+    std::unordered_set<string_view> labels;
+
+    bool isLabel(string_view name) const {
+        return this->labels.count(name) != 0;
+    }
+
+    // Append name renumbered to renamed. name is a register, label, or global, with its sigil if it has one
+    void renumber(string_view name, string &renamed) const {
+        size_t digits = name.size();
+        while (digits > 0 and isdigit((unsigned char)name[digits - 1])) {
+            digits--;
+        }
+
+        long number = atol(name.data() + digits);
+        bool isAllocated = number >= this->firstRegNumber and number < this->firstRegNumber + this->regCount;
+        long delta = 0;
+        if (digits == name.size()) {
+            delta = 0;
+        } else if (name[0] == '@') {
+            delta = 0;
+        } else if (this->isLabel(name[0] == '%' ? name.substr(1) : name)) {
+            delta = this->labelDelta;
+        } else if (name[0] == '%' and isAllocated) {
+            delta = this->regDelta;
+        }
+
+        if (delta == 0) {
+            renamed += name;
+            return;
+        }
+        renamed += name.substr(0, digits);
+        renamed += std::to_string(number + delta);
+    }
+};
+
+// Append line to renamed, with its registers and labels renumbered. Everything but the names is
+// copied in bulk
+static void renameAll(string_view line, const Renumbering &renumbering, string &renamed) {
+    size_t i = std::min(line.find_first_not_of('\t'), line.size());
+    renamed += line.substr(0, i);
+    // A name at the start of a line can only be a label being defined
+    if (i < line.size() and isNameChar(line[i])) {
+        size_t length = getNameLength(line, i);
+        renumbering.renumber(line.substr(i, length), renamed);
+        i += length;
+    }
+
+    for (size_t sigil; (sigil = line.find_first_of("%@", i)) != string::npos; i = sigil + getNameLength(line, sigil)) {
+        renamed += line.substr(i, sigil - i);
+        renumbering.renumber(line.substr(sigil, getNameLength(line, sigil)), renamed);
+    }
+    renamed += line.substr(i);
+}
+
+void FunctionCache::splice() {
+    PhaseScope phase(Phase::CACHE);
+    const double start = activeTrace ? TraceRecorder::now() : 0;
+    auto &compilation = Compilation::current();
+    if (this->currentFunction >= this->functions.size() or not this->functions[this->currentFunction].cached) {
+        throw Exception("Code error. Spliced a function that isn't in the function cache");
+    }
+    Function &function = this->functions[this->currentFunction];
+    const Entry &entry = *function.cached;
+
+    this->startFunction();
+    CodeBuffer &buffer = compilation.codeBuffer;
+    Renumbering renumbering;
+    renumbering.firstRegNumber = entry.firstRegNumber;
+    renumbering.regCount = entry.regCount;
+    renumbering.regDelta = function.firstRegNumber - entry.firstRegNumber;
+    renumbering.labelDelta = (long)function.firstCodeLocation - (long)entry.firstCodeLocation;
+    const int lineDelta = function.firstLine - entry.firstLine;
+
+    // Functions before the first edit are where they were when they were cached, and are copied as is
+    if (renumbering.regDelta == 0 and renumbering.labelDelta == 0 and lineDelta == 0) {
+        forEachLine(entry.globals, [&](string_view line) { buffer.emitGlobal(string(line)); });
+        forEachLine(entry.code, [&](string_view line) { buffer.emitVerbatim(string(line)); });
+    } else {
+        forEachLine(entry.code, [&](string_view line) {
+            size_t start = line.find_first_not_of('\t');
+            if (start != string::npos and isNameChar(line[start])) {
+                size_t length = getNameLength(line, start);
+                if (line.substr(start + length, 1) == ":") {
+                    renumbering.labels.insert(line.substr(start, length));
+                }
+            }
+        });
+
+        string renamed;
+        forEachLine(entry.globals, [&](string_view line) {
+            // The contents of a string constant are copied as is
+            size_t contents = std::min(line.find("c\""), line.size());
+            renamed.clear();
+            renameAll(line.substr(0, contents), renumbering, renamed);
+            renamed += line.substr(contents);
+            buffer.emitGlobal(renamed);
+        });
+        forEachLine(entry.code, [&](string_view line) {
+            // Every line ends with the source line it was emitted at
+            size_t suffix = line.rfind(" ; ");
+            renamed.clear();
+            renameAll(line.substr(0, suffix), renumbering, renamed);
+            renamed += " ; ";
+            renamed += std::to_string(atoi(line.data() + suffix + 3) + lineDelta);
+            buffer.emitVerbatim(renamed);
+        });
+    }
+    compilation.ralloc.skipNumbers(entry.regCount);
+    auto funcId = NEW(FuncIdC, (function.name, entry.retType, entry.argTypes));
+    funcId->setEffects(entry.effects);
+    compilation.symbolTable.addSymbol(funcId);
+
+    this->endFunction();
+    this->hitCount++;
+    countStat(&CompileStats::functions);
+    countStat(&CompileStats::cachedFunctions);
+    if (activeTrace) {
+        activeTrace->complete("function " + compilation.interner.getName(function.name), "cached function", start);
+        traceBufferSize(compilation.codeBuffer);
+    }
+}
+
+int FunctionCache::getHitCount() const {
+    return this->hitCount;
+}
+
+int FunctionCache::getFunctionCount() const {
+    return this->functions.size();
+}
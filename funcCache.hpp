@@ -0,0 +1,98 @@
+#ifndef FUNC_CACHE_H_
+#define FUNC_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "interner.hpp"
+#include "io.hpp"
+#include "tokenStream.hpp"
+#include "types.hpp"
+
+// On disk cache of the IR of every function of a source, so that recompiling it after an edit only lowers the
+// functions that changed and their callers. A function is looked up by a hash of its tokens (with their relative
+// lines) and of what each identifier in it refers to outside of it, i.e. the signatures and keys of the functions it
+// calls, since its attributes are inferred from theirs. A cached function skips
+// the parser altogether, and its IR is spliced into the code buffer with its registers, labels, string globals and
+// line numbers renumbered to what lowering it again would give, so the output is the same either way
+class FunctionCache {
+   public:
+    struct Key {
+        uint64_t high;
+        uint64_t low;
+        bool operator==(const Key &other) const;
+    };
+
+   private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    // The IR of a function, numbered as it was when the function was lowered. The code is viewed in place in the
+    // mapped cache file
+    struct Entry {
+        std::string name;
+        TypeName retType;
+        std::vector<TypeName> argTypes;
+        int firstRegNumber;
+        int regCount;
+        // Location in the code buffer, which labels are numbered by
+        size_t firstCodeLocation;
+        int firstLine;
+        // FunctionEffect flags
+        int effects;
+        // Lines each ending with a newline
+        std::string_view code;
+        std::string_view globals;
+    };
+
+    // A function of the source being compiled
+    struct Function {
+        Key key;
+        SymbolId name;
+        int firstLine;
+        // The cache entry to splice instead of lowering the function, or null
+        const Entry *cached;
+        // Where the function's IR ended up in this compilation
+        int firstRegNumber;
+        int regCount;
+        size_t firstCodeLocation;
+        size_t codeEnd;
+        size_t firstGlobal;
+        size_t globalEnd;
+    };
+
+    std::string path;
+    SourceFile file;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::vector<Function> functions;
+    // Index in functions of the function being lowered or spliced
+    size_t currentFunction;
+    int hitCount;
+
+   public:
+    explicit FunctionCache(const std::string &path);
+    FunctionCache(const FunctionCache &) = delete;
+    void operator=(const FunctionCache &) = delete;
+    // Path of the cache file of sourceName in directory
+    static std::string getCachePath(const std::string &directory, const std::string &sourceName);
+    // Read the cache file, if there is one. A file that can't be read is treated as empty
+    void load();
+    // Find the functions in tokens, and replace each one that is in the cache with a CACHED_FUNC token
+    void prepare(std::vector<Token> &tokens);
+    // Called around the lowering of each function that isn't in the cache
+    void startFunction();
+    void endFunction();
+    // Emit the cached IR of the next function, renumbered to its place in this compilation, and declare it
+    void splice();
+    // Replace the cache file with the functions of this compilation. Returns false (with errno set) on failure
+    bool save() const;
+    int getHitCount() const;
+    int getFunctionCount() const;
+};
+
+#endif
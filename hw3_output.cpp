@@ -49,81 +49,79 @@ string output::makeFunctionType(const string& retType, std::vector<string>& argT
 }
 
 void output::errorLex(int lineno) {
-    cout << "line " << lineno << ":"
-         << " lexical error" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ":"
+            << " lexical error";
+    throw CompileError(message.str());
 }
 
 void output::errorSyn(int lineno) {
-    cout << "line " << lineno << ":"
-         << " syntax error" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ":"
+            << " syntax error";
+    throw CompileError(message.str());
 }
 
 void output::errorUndef(int lineno, const string& id) {
-    cout << "line " << lineno << ":"
-         << " variable " << id << " is not defined" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ":"
+            << " variable " << id << " is not defined";
+    throw CompileError(message.str());
 }
 
 void output::errorDef(int lineno, const string& id) {
-    cout << "line " << lineno << ":"
-         << " identifier " << id << " is already defined" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ":"
+            << " identifier " << id << " is already defined";
+    throw CompileError(message.str());
 }
 
 void output::errorUndefFunc(int lineno, const string& id) {
-    cout << "line " << lineno << ":"
-         << " function " << id << " is not defined" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ":"
+            << " function " << id << " is not defined";
+    throw CompileError(message.str());
 }
 
 void output::errorMismatch(int lineno) {
-    cout << "line " << lineno << ":"
-         << " type mismatch" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ":"
+            << " type mismatch";
+    throw CompileError(message.str());
 }
 
 void output::errorPrototypeMismatch(int lineno, const string& id, std::vector<string>& argTypes) {
-    cout << "line " << lineno << ": prototype mismatch, function " << id << " expects arguments " << typeListToString(argTypes) << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ": prototype mismatch, function " << id << " expects arguments " << typeListToString(argTypes);
+    throw CompileError(message.str());
 }
 
 void output::errorUnexpectedBreak(int lineno) {
-    cout << "line " << lineno << ":"
-         << " unexpected break statement" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ":"
+            << " unexpected break statement";
+    throw CompileError(message.str());
 }
 
 void output::errorUnexpectedContinue(int lineno) {
-    cout << "line " << lineno << ":"
-         << " unexpected continue statement" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ":"
+            << " unexpected continue statement";
+    throw CompileError(message.str());
 }
 
 void output::errorMainMissing() {
-    cout << "Program has no 'void main()' function" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "Program has no 'void main()' function";
+    throw CompileError(message.str());
 }
 
 void output::errorByteTooLarge(int lineno, const string& value) {
-    cout << "line " << lineno << ": byte value " << value << " out of range" << endl;
-
-    ::exit(0);
+    stringstream message;
+    message << "line " << lineno << ": byte value " << value << " out of range";
+    throw CompileError(message.str());
 }
 
 int yyerror(const char* message) {
     output::errorSyn(yylineno);
-
-    ::exit(0);
 }
@@ -7,6 +7,15 @@
 
 using namespace std;
 
+// Thrown by the error functions below with the message to output instead of the code. Compilation stops at the first error
+class CompileError : public std::exception {
+    string message;
+
+   public:
+    explicit CompileError(const string& message) : message(message) {}
+    const char* what() const noexcept override { return message.c_str(); }
+};
+
 namespace output {
 void endScope();
 void printID(const string& id, int offset, const string& type);
@@ -16,20 +25,20 @@ void printID(const string& id, int offset, const string& type);
 */
 string makeFunctionType(const string& retType, vector<string>& argTypes);
 
-void errorLex(int lineno);
-void errorSyn(int lineno);
-void errorUndef(int lineno, const string& id);
-void errorDef(int lineno, const string& id);
-void errorUndefFunc(int lineno, const string& id);
-void errorMismatch(int lineno);
-void errorPrototypeMismatch(int lineno, const string& id, vector<string>& argTypes);
-void errorUnexpectedBreak(int lineno);
-void errorUnexpectedContinue(int lineno);
-void errorMainMissing();
-void errorByteTooLarge(int lineno, const string& value);
+[[noreturn]] void errorLex(int lineno);
+[[noreturn]] void errorSyn(int lineno);
+[[noreturn]] void errorUndef(int lineno, const string& id);
+[[noreturn]] void errorDef(int lineno, const string& id);
+[[noreturn]] void errorUndefFunc(int lineno, const string& id);
+[[noreturn]] void errorMismatch(int lineno);
+[[noreturn]] void errorPrototypeMismatch(int lineno, const string& id, vector<string>& argTypes);
+[[noreturn]] void errorUnexpectedBreak(int lineno);
+[[noreturn]] void errorUnexpectedContinue(int lineno);
+[[noreturn]] void errorMainMissing();
+[[noreturn]] void errorByteTooLarge(int lineno, const string& value);
 
 }  // namespace output
 
-int yyerror(const char* message);
+[[noreturn]] int yyerror(const char* message);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "interner.hpp"
+
+#include "compilation.hpp"
+#include "stats.hpp"
+
+using std::string;
+using std::string_view;
+
+static const size_t INITIAL_SLOTS = 256;
+
+// FNV-1a
+static size_t hashName(string_view name) {
+    size_t hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ (unsigned char)c) * 16777619u;
+    }
+    return hash;
+}
+
+Interner::Interner() : names(), slots(INITIAL_SLOTS, -1) {
+    countAllocation(Subsystem::INTERNER, this->slots.size() * sizeof(SymbolId));
+}
+
+Interner &Interner::instance() {
+    return Compilation::current().interner;
+}
+
+SymbolId Interner::intern(string_view name) {
+    size_t mask = this->slots.size() - 1;
+    size_t i = hashName(name) & mask;
+
+    // Linear probing until we find the name or an empty slot for it
+    while (this->slots[i] != -1) {
+        if (this->names[this->slots[i]] == name) {
+            return this->slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+
+    SymbolId id = this->names.size();
+    this->names.emplace_back(name);
+    countString(Subsystem::INTERNER, this->names.back());
+    this->slots[i] = id;
+
+    // Keep the load factor under 1/2
+    if (this->names.size() * 2 > this->slots.size()) {
+        this->grow();
+    }
+
+    return id;
+}
+
+void Interner::grow() {
+    this->slots.assign(this->slots.size() * 2, -1);
+    countAllocation(Subsystem::INTERNER, this->slots.size() * sizeof(SymbolId));
+    size_t mask = this->slots.size() - 1;
+
+    for (SymbolId id = 0; id < (SymbolId)this->names.size(); id++) {
+        size_t i = hashName(this->names[id]) & mask;
+        while (this->slots[i] != -1) {
+            i = (i + 1) & mask;
+        }
+        this->slots[i] = id;
+    }
+}
+
+const string &Interner::getName(SymbolId id) const {
+    return this->names[id];
+}
+
+int Interner::size() const {
+    return this->names.size();
+}
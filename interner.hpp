@@ -0,0 +1,37 @@
+#ifndef INTERNER_H_
+#define INTERNER_H_
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Dense id of an identifier. Equal names always get the same id
+typedef int SymbolId;
+
+// Singleton class for mapping identifier names to dense ids, so the rest of the compiler never compares names
+class Interner {
+    friend class Compilation;
+
+   private:
+    // Stable storage for the names, indexed by SymbolId
+    std::deque<std::string> names;
+    // Open addressing hash table of SymbolIds (-1 marks an empty slot). Size is always a power of 2
+    std::vector<SymbolId> slots;
+    // Constructor
+    Interner();
+    Interner(const Interner &) = delete;
+    void grow();
+
+   public:
+    // The interner of the current compilation
+    static Interner &instance();
+    // Get the id of name, adding it if it wasn't seen before. Doesn't allocate for known names
+    SymbolId intern(std::string_view name);
+    // Get the name of an interned id
+    const std::string &getName(SymbolId id) const;
+    // Number of distinct names interned so far
+    int size() const;
+};
+
+#endif
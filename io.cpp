@@ -0,0 +1,180 @@
+#include "io.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+// flex needs two YY_END_OF_BUFFER_CHARs (NUL) after the scanned text
+static const size_t TERMINATORS_SIZE = 2;
+
+SourceFile::SourceFile() : data(nullptr), length(0), mappedSize(0), contents() {}
+
+SourceFile::~SourceFile() {
+    if (this->mappedSize != 0) {
+        munmap(this->data, this->mappedSize);
+    }
+}
+
+bool SourceFile::open(const char *path) {
+    int fd = path ? ::open(path, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = this->load(fd);
+
+    if (path) {
+        int savedErrno = errno;
+        close(fd);
+        errno = savedErrno;
+    }
+    return ok;
+}
+
+bool SourceFile::load(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    return S_ISREG(st.st_mode) ? this->mapFile(fd, st.st_size) : this->readFile(fd);
+}
+
+bool SourceFile::mapFile(int fd, size_t fileSize) {
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t mappedSize = (fileSize + TERMINATORS_SIZE + pageSize - 1) / pageSize * pageSize;
+
+    // Reserve zeroed memory for the source and its terminators, then map the file over its start. The rest of the
+    // file's last page is zero filled by mmap, so the terminators are there whether or not they fall on that page.
+    // The mapping is private and writable since flex temporarily writes NULs after each token
+    void *base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    if (fileSize != 0 and mmap(base, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int savedErrno = errno;
+        munmap(base, mappedSize);
+        errno = savedErrno;
+        return false;
+    }
+
+    this->data = static_cast<char *>(base);
+    this->length = fileSize;
+    this->mappedSize = mappedSize;
+    return true;
+}
+
+bool SourceFile::readFile(int fd) {
+    char chunk[1 << 16];
+    ssize_t readSize;
+
+    while ((readSize = read(fd, chunk, sizeof(chunk))) != 0) {
+        if (readSize < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        this->contents.append(chunk, readSize);
+    }
+
+    this->length = this->contents.size();
+    this->contents.append(TERMINATORS_SIZE, '\0');
+    this->data = &this->contents[0];
+    return true;
+}
+
+char *SourceFile::getBuffer() {
+    return this->data;
+}
+
+size_t SourceFile::getBufferSize() const {
+    return this->length + TERMINATORS_SIZE;
+}
+
+const char *SourceFile::getSource() const {
+    return this->data;
+}
+
+size_t SourceFile::getSourceSize() const {
+    return this->length;
+}
+
+OutputWriter::OutputWriter() : OutputWriter(STDOUT_FILENO) {}
+
+OutputWriter::OutputWriter(int fd) : fd(fd), ownsFd(false), chunk(new char[CHUNK_SIZE]), used(0), writeErrno(0) {}
+
+OutputWriter::~OutputWriter() {
+    this->flush();
+    if (this->ownsFd) {
+        close(this->fd);
+    }
+    delete[] this->chunk;
+}
+
+bool OutputWriter::open(const char *path) {
+    int newFd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (newFd < 0) {
+        return false;
+    }
+
+    this->flush();
+    if (this->ownsFd) {
+        close(this->fd);
+    }
+    this->fd = newFd;
+    this->ownsFd = true;
+    return true;
+}
+
+void OutputWriter::writeAll(const char *data, size_t size) {
+    while (size != 0 and this->writeErrno == 0) {
+        ssize_t written = ::write(this->fd, data, size);
+        if (written < 0) {
+            if (errno != EINTR) {
+                this->writeErrno = errno;
+            }
+            continue;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+void OutputWriter::write(const char *data, size_t size) {
+    if (this->used + size > CHUNK_SIZE) {
+        this->flush();
+        // Anything that doesn't fit in an empty chunk goes out directly
+        if (size >= CHUNK_SIZE) {
+            this->writeAll(data, size);
+            return;
+        }
+    }
+
+    memcpy(this->chunk + this->used, data, size);
+    this->used += size;
+}
+
+void OutputWriter::write(const std::string &str) {
+    this->write(str.data(), str.size());
+}
+
+void OutputWriter::writeLine(const std::string &line) {
+    this->write(line.data(), line.size());
+    this->write("\n", 1);
+}
+
+bool OutputWriter::flush() {
+    this->writeAll(this->chunk, this->used);
+    this->used = 0;
+
+    if (this->writeErrno != 0) {
+        errno = this->writeErrno;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef IO_H_
+#define IO_H_
+
+#include <cstddef>
+#include <string>
+
+// The whole source of a compilation, kept in memory so tokens can be views into it.
+// Regular files are mmapped, anything else (pipes, terminals) is read into memory
+class SourceFile {
+   private:
+    char *data;
+    // Length of the source itself, not counting the terminators
+    size_t length;
+    // Size of the mapping, or 0 if the source was read into `contents`
+    size_t mappedSize;
+    std::string contents;
+
+    bool mapFile(int fd, size_t fileSize);
+    bool readFile(int fd);
+
+   public:
+    SourceFile();
+    SourceFile(const SourceFile &) = delete;
+    void operator=(const SourceFile &) = delete;
+    ~SourceFile();
+    // Load the source from path, or from stdin if path is null. Returns false (with errno set) on failure
+    bool open(const char *path);
+    // Load the source from fd up to its end, without closing it. Returns false (with errno set) on failure
+    bool load(int fd);
+    // The source itself, without the terminators
+    const char *getSource() const;
+    size_t getSourceSize() const;
+    // Writable buffer holding the source followed by two NUL chars, as flex's yy_scan_buffer expects
+    char *getBuffer();
+    // Size of getBuffer(), including the two terminators
+    size_t getBufferSize() const;
+};
+
+// Collects output in large chunks so it reaches the file descriptor in a few write calls instead of one per line
+class OutputWriter {
+   private:
+    static const size_t CHUNK_SIZE = 1 << 20;
+
+    int fd;
+    bool ownsFd;
+    char *chunk;
+    size_t used;
+    // Set once a write fails. Everything written afterwards is dropped
+    int writeErrno;
+
+    void writeAll(const char *data, size_t size);
+
+   public:
+    // Write to stdout until open() is called
+    OutputWriter();
+    // Write to fd, without closing it
+    explicit OutputWriter(int fd);
+    OutputWriter(const OutputWriter &) = delete;
+    void operator=(const OutputWriter &) = delete;
+    ~OutputWriter();
+    // Redirect the output to path, truncating it. Returns false (with errno set) on failure
+    bool open(const char *path);
+    void write(const char *data, size_t size);
+    void write(const std::string &str);
+    void writeLine(const std::string &line);
+    // Returns false (with errno set) if any write so far failed
+    bool flush();
+};
+
+#endif
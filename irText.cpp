@@ -0,0 +1,61 @@
+#include "irText.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+using std::string;
+using std::vector;
+
+bool isNameChar(char c) {
+    return isalnum((unsigned char)c) or c == '_' or c == '.' or c == '$' or c == '-';
+}
+
+int getBits(const string &type) {
+    if (type.size() < 2 or type[0] != 'i' or type.find_first_not_of("0123456789", 1) != string::npos) {
+        return 0;
+    }
+    return atoi(type.c_str() + 1);
+}
+
+vector<string> splitInstruction(const string &instruction) {
+    vector<string> words;
+    string word;
+    std::istringstream stream(instruction);
+    while (stream >> word) {
+        while (not word.empty() and word.back() == ',') {
+            word.pop_back();
+        }
+        if (not word.empty()) {
+            words.push_back(word);
+        }
+    }
+    return words;
+}
+
+string getBody(const string &line) {
+    size_t suffix = line.rfind(" ; ");
+    size_t indentation = std::min(line.find_first_not_of('\t'), line.size());
+    // Metadata comes after any string constant, which may have ", !" in it
+    size_t quote = line.rfind('"', suffix);
+    size_t metadata = line.find(", !", quote == string::npos ? 0 : quote);
+    size_t end = std::min(suffix == string::npos ? line.size() : suffix, metadata);
+    return end <= indentation ? "" : line.substr(indentation, end - indentation);
+}
+
+string substitute(const string &line, const std::unordered_map<string, string> &names) {
+    string substituted;
+    size_t i = 0;
+    for (size_t sigil; (sigil = line.find('%', i)) != string::npos;) {
+        size_t end = sigil + 1;
+        while (end < line.size() and isNameChar(line[end])) {
+            end++;
+        }
+        substituted += line.substr(i, sigil - i);
+        auto name = names.find(line.substr(sigil, end - sigil));
+        substituted += name == names.end() ? line.substr(sigil, end - sigil) : name->second;
+        i = end;
+    }
+    return substituted + line.substr(i);
+}
@@ -0,0 +1,25 @@
+#ifndef IR_TEXT_H_
+#define IR_TEXT_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reading the lines of the code buffer, which the passes that work on the lowered IR go through as text
+
+// Whether c can be part of a register, label or global name after its sigil
+bool isNameChar(char c);
+
+// Width of an integer type (e.g. 32 for "i32"), or 0 for other types
+int getBits(const std::string &type);
+
+// The words of an instruction, split at whitespace and commas
+std::vector<std::string> splitInstruction(const std::string &instruction);
+
+// line without its indentation, line number comment and metadata (like the ", !prof !1" of a weighted branch)
+std::string getBody(const std::string &line);
+
+// Replace the registers and labels in line that are keys of names with their values
+std::string substitute(const std::string &line, const std::unordered_map<std::string, std::string> &names);
+
+#endif
@@ -0,0 +1,914 @@
+#include "loops.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "bp.hpp"
+#include "irText.hpp"
+#include "ralloc.hpp"
+#include "stats.hpp"
+#include "symbolTable.hpp"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+// Loops are only looked at up to this many lines
+static const size_t MAX_LOOP_LINES = 200;
+// Conditions of loops are only copied to rotate them up to this many lines
+static const size_t MAX_ROTATED_CONDITION_LINES = 50;
+
+// A value the loop doesn't compute: a variable's value when an iteration starts, a register from before the loop, or
+// a zext or sext of one of those
+struct Atom {
+    // Offset of the variable in the frame, or -1
+    int slot;
+    // The register, or the cast
+    string name;
+    // The atom cast, or -1
+    int inner;
+    int bits;
+
+    bool operator==(const Atom &other) const {
+        return slot == other.slot and name == other.name and inner == other.inner and bits == other.bits;
+    }
+};
+
+// constant + the sum of coefficient * atom, modulo 2^64. Only the bits of the type it was computed in matter
+struct Affine {
+    std::map<int, uint64_t> terms;
+    uint64_t constant = 0;
+};
+
+static Affine combine(const Affine &a, const Affine &b, uint64_t bFactor) {
+    Affine result = a;
+    result.constant += bFactor * b.constant;
+    for (auto &term : b.terms) {
+        result.terms[term.first] += bFactor * term.second;
+    }
+    return result;
+}
+
+static Affine scale(const Affine &a, uint64_t factor) {
+    return combine(Affine(), a, factor);
+}
+
+static uint64_t getMask(int bits) {
+    return bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+}
+
+static int64_t toSigned(uint64_t value, int bits) {
+    value &= getMask(bits);
+    return bits < 64 and (value >> (bits - 1)) ? (int64_t)(value - (1ULL << bits)) : (int64_t)value;
+}
+
+// What one iteration of the loop does to the variables in the frame, found by going through its code once with
+// symbolic values. A tolerant analysis goes through instructions it doesn't know, whose results are then unknown
+class LoopAnalysis {
+    // What a register holds: an affine value, the address of a variable in the frame, a comparison of affine values, or
+    // something else
+    struct Value {
+        enum class Kind { AFFINE, POINTER, CONDITION, UNKNOWN } kind;
+        Affine affine;
+        Affine right;
+        int slot;
+        int bits;
+        string predicate;
+    };
+
+    const string &frameReg;
+    bool tolerant;
+    std::unordered_map<string, Value> registers;
+
+    int getAtom(const Atom &atom) {
+        for (size_t i = 0; i < this->atoms.size(); i++) {
+            if (this->atoms[i] == atom) {
+                return i;
+            }
+        }
+        this->atoms.push_back(atom);
+        return this->atoms.size() - 1;
+    }
+
+    // Check that slot is always accessed as bits wide
+    bool accessSlot(int slot, int bits) {
+        auto found = this->slotBits.emplace(slot, bits).first;
+        return found->second == bits;
+    }
+
+    bool getOperand(const string &text, int bits, Affine &value) {
+        value = Affine();
+        if (text == "true" or text == "false") {
+            value.constant = text == "true";
+            return true;
+        }
+        if (text[0] == '%') {
+            auto found = this->registers.find(text);
+            if (found == this->registers.end()) {
+                value.terms[this->getAtom({-1, text, -1, bits})] = 1;
+                return true;
+            }
+            value = found->second.affine;
+            return found->second.kind == Value::Kind::AFFINE;
+        }
+        size_t digits = text[0] == '-' ? 1 : 0;
+        if (digits == text.size() or text.find_first_not_of("0123456789", digits) != string::npos) {
+            return false;
+        }
+        value.constant = (uint64_t)atoll(text.c_str());
+        return true;
+    }
+
+   public:
+    vector<Atom> atoms;
+    // Width of each variable accessed, and the value of those stored to at the end of the iteration
+    std::map<int, int> slotBits;
+    std::map<int, Affine> stored;
+    // Variables stored unknown values to, by a tolerant analysis
+    std::set<int> clobbered;
+
+    LoopAnalysis(const string &frameReg, bool tolerant)
+        : frameReg(frameReg), tolerant(tolerant), registers(), atoms(), slotBits(), stored(), clobbered() {}
+
+    // The atom of slot's value when the iteration starts
+    int getSlotAtom(int slot) {
+        return this->getAtom({slot, "", -1, this->slotBits[slot]});
+    }
+
+    // Whether the register holds a comparison, and its operands and predicate
+    bool getCondition(const string &reg, Affine &left, Affine &right, string &predicate, int &bits) {
+        auto found = this->registers.find(reg);
+        if (found == this->registers.end() or found->second.kind != Value::Kind::CONDITION) {
+            return false;
+        }
+        left = found->second.affine;
+        right = found->second.right;
+        predicate = found->second.predicate;
+        bits = found->second.bits;
+        return true;
+    }
+
+    // Go through an instruction, or return false if it isn't one the analysis knows
+    bool step(const string &body) {
+        vector<string> words = splitInstruction(body);
+        if (words.size() == 5 and words[0] == "store") {
+            auto pointer = this->registers.find(words[4]);
+            int bits = getBits(words[1]);
+            if (this->tolerant and words[4][0] == '@') {
+                return true;
+            }
+            if (pointer == this->registers.end() or pointer->second.kind != Value::Kind::POINTER or
+                pointer->second.bits != bits or not this->accessSlot(pointer->second.slot, bits)) {
+                return false;
+            }
+            int slot = pointer->second.slot;
+            Affine value;
+            if (not this->getOperand(words[2], bits, value)) {
+                this->stored.erase(slot);
+                this->clobbered.insert(slot);
+                return this->tolerant;
+            }
+            this->stored[slot] = value;
+            this->clobbered.erase(slot);
+            return true;
+        }
+        if (words.size() < 3 or words[1] != "=") {
+            return this->tolerant;
+        }
+        if (this->registers.count(words[0])) {
+            return false;
+        }
+        // Values the tolerant analysis doesn't know don't matter unless they are stored
+        Value result = {Value::Kind::AFFINE, Affine(), Affine(), -1, 0, ""};
+        if (not this->evaluate(words, result)) {
+            if (not this->tolerant) {
+                return false;
+            }
+            result.kind = Value::Kind::UNKNOWN;
+        }
+        this->registers[words[0]] = result;
+        return true;
+    }
+
+   private:
+    // The value of the instruction with a result in words, or false if the analysis doesn't know it
+    bool evaluate(const vector<string> &words, Value &result) {
+        if (words.size() < 6) {
+            return false;
+        }
+        const string &op = words[2];
+        if ((op == "add" or op == "sub" or op == "mul") and words.size() == 6) {
+            int bits = getBits(words[3]);
+            Affine a, b;
+            if (bits == 0 or not this->getOperand(words[4], bits, a) or not this->getOperand(words[5], bits, b)) {
+                return false;
+            }
+            if (op == "mul") {
+                if (not a.terms.empty() and not b.terms.empty()) {
+                    return false;
+                }
+                result.affine = a.terms.empty() ? scale(b, a.constant) : scale(a, b.constant);
+            } else {
+                result.affine = combine(a, b, op == "add" ? 1 : -1);
+            }
+        } else if (op == "icmp" and words.size() == 7) {
+            result.kind = Value::Kind::CONDITION;
+            result.predicate = words[3];
+            result.bits = getBits(words[4]);
+            if (result.bits == 0 or not this->getOperand(words[5], result.bits, result.affine) or
+                not this->getOperand(words[6], result.bits, result.right)) {
+                return false;
+            }
+        } else if ((op == "trunc" or op == "zext" or op == "sext") and words.size() == 7) {
+            int fromBits = getBits(words[3]);
+            int bits = getBits(words[6]);
+            Affine operand;
+            if (fromBits == 0 or bits == 0 or not this->getOperand(words[4], fromBits, operand)) {
+                return false;
+            }
+            if (op == "trunc") {
+                result.affine = operand;
+            } else if (operand.terms.empty()) {
+                uint64_t constant = operand.constant & getMask(fromBits);
+                result.affine.constant = op == "sext" ? (uint64_t)toSigned(constant, fromBits) : constant;
+            } else {
+                // Extending isn't affine, so only an atom can be, which the loop must not change
+                if (operand.terms.size() != 1 or (operand.terms.begin()->second & getMask(fromBits)) != 1 or
+                    (operand.constant & getMask(fromBits)) != 0) {
+                    return false;
+                }
+                result.affine.terms[this->getAtom({-1, op, operand.terms.begin()->first, bits})] = 1;
+            }
+        } else if (op == "getelementptr" and words.size() == 8 and words[3] == "i32" and words[5] == this->frameReg) {
+            Affine offset;
+            if (not this->getOperand(words[7], 32, offset) or not offset.terms.empty()) {
+                return false;
+            }
+            result.kind = Value::Kind::POINTER;
+            result.slot = (int)offset.constant;
+            result.bits = 32;
+        } else if (op == "bitcast" and words.size() == 7 and words[6].back() == '*') {
+            auto pointer = this->registers.find(words[4]);
+            if (pointer == this->registers.end() or pointer->second.kind != Value::Kind::POINTER) {
+                return false;
+            }
+            result = pointer->second;
+            result.bits = getBits(words[6].substr(0, words[6].size() - 1));
+        } else if (op == "load" and words.size() == 6 and words[5][0] == '%') {
+            auto pointer = this->registers.find(words[5]);
+            int bits = getBits(words[3]);
+            if (pointer == this->registers.end() or pointer->second.kind != Value::Kind::POINTER or
+                pointer->second.bits != bits or not this->accessSlot(pointer->second.slot, bits)) {
+                return false;
+            }
+            int slot = pointer->second.slot;
+            auto value = this->stored.find(slot);
+            if (this->clobbered.count(slot)) {
+                return false;
+            } else if (value != this->stored.end()) {
+                result.affine = value->second;
+            } else {
+                result.affine.terms[this->getSlotAtom(slot)] = 1;
+            }
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// Find the loop just lowered, from the label condLabel, entered by the branch right before it, to end, the branch
+// back to it at the end of the code buffer
+static bool findLoop(const string &condLabel, size_t &labelAddress, size_t &end) {
+    auto &buffer = CodeBuffer::instance();
+    end = buffer.getCodeSize() - 1;
+    if (getBody(buffer.getCodeLine(end)) != "br label %" + condLabel) {
+        return false;
+    }
+    labelAddress = end;
+    while (labelAddress > 0 and end - labelAddress < MAX_LOOP_LINES and getBody(buffer.getCodeLine(labelAddress)) != condLabel + ":") {
+        labelAddress--;
+    }
+    return labelAddress > 0 and getBody(buffer.getCodeLine(labelAddress - 1)) == "br label %" + condLabel;
+}
+
+int emitClosedForm(const string &condLabel, const string &frameReg) {
+    auto &buffer = CodeBuffer::instance();
+    auto &ralloc = Ralloc::instance();
+    // The branch entering the loop goes to the closed form instead
+    size_t labelAddress, end;
+    if (not findLoop(condLabel, labelAddress, end)) {
+        return -1;
+    }
+
+    // The condition, then the body, with no other blocks
+    LoopAnalysis loop(frameReg, false);
+    string conditionReg;
+    string bodyLabel;
+    bool inBody = false;
+    for (size_t address = labelAddress + 1; address < end; address++) {
+        string body = getBody(buffer.getCodeLine(address));
+        if (body.empty() or body[0] == ';') {
+            continue;
+        }
+        vector<string> words = splitInstruction(body);
+        if (not inBody and words.size() == 7 and words[0] == "br" and words[1] == "i1" and words[6] == "@") {
+            conditionReg = words[2];
+            bodyLabel = words[4].substr(1);
+            if (++address >= end or getBody(buffer.getCodeLine(address)) != bodyLabel + ":") {
+                return -1;
+            }
+            inBody = true;
+        } else if (not loop.step(body)) {
+            return -1;
+        }
+    }
+    Affine left, right;
+    string predicate;
+    int bits;
+    if (not inBody or not loop.getCondition(conditionReg, left, right, predicate, bits)) {
+        return -1;
+    }
+
+    // Counters add a constant. Accumulators add values of other atoms the loop doesn't change and of counters
+    std::map<int, uint64_t> steps;
+    std::map<int, Affine> increments;
+    for (auto &variable : loop.stored) {
+        int atom = loop.getSlotAtom(variable.first);
+        Affine increment = variable.second;
+        if (((increment.terms[atom] - 1) & getMask(loop.slotBits[variable.first])) != 0) {
+            return -1;
+        }
+        increment.terms.erase(atom);
+        if (increment.terms.empty()) {
+            steps[atom] = increment.constant;
+        } else {
+            increments[variable.first] = increment;
+        }
+    }
+    auto isInvariant = [&](int atom) {
+        const Atom &inner = loop.atoms[loop.atoms[atom].inner >= 0 ? loop.atoms[atom].inner : atom];
+        return inner.slot < 0 or not loop.stored.count(inner.slot);
+    };
+    // How much the increments grow with each iteration
+    std::map<int, uint64_t> slopes;
+    for (auto &variable : increments) {
+        for (auto &term : variable.second.terms) {
+            if (steps.count(term.first)) {
+                if (loop.atoms[term.first].bits < loop.slotBits[variable.first]) {
+                    return -1;
+                }
+                slopes[variable.first] += term.second * steps[term.first];
+            } else if (not isInvariant(term.first)) {
+                return -1;
+            }
+        }
+    }
+
+    // The condition compares a counter, plus a constant, to an invariant value
+    auto isCounter = [&](const Affine &value) {
+        return value.terms.size() == 1 and (value.terms.begin()->second & getMask(bits)) == 1 and
+               steps.count(value.terms.begin()->first) and loop.atoms[value.terms.begin()->first].bits == bits;
+    };
+    auto isInvariantValue = [&](const Affine &value) {
+        for (auto &term : value.terms) {
+            if (not isInvariant(term.first)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (not isCounter(left) or not isInvariantValue(right)) {
+        if (not isCounter(right) or not isInvariantValue(left)) {
+            return -1;
+        }
+        std::swap(left, right);
+        static const std::map<string, string> swapped = {{"slt", "sgt"}, {"sle", "sge"}, {"sgt", "slt"}, {"sge", "sle"},
+                                                         {"ult", "ugt"}, {"ule", "uge"}, {"ugt", "ult"}, {"uge", "ule"},
+                                                         {"ne", "ne"}};
+        auto found = swapped.find(predicate);
+        if (found == swapped.end()) {
+            return -1;
+        }
+        predicate = found->second;
+    }
+    int64_t step = toSigned(steps[left.terms.begin()->first], bits);
+    bool isSigned = predicate[0] == 's';
+    string comparison = predicate == "ne" ? predicate : predicate.substr(1);
+    bool counting = (comparison == "lt" or comparison == "le") and step > 0;
+    bool countingDown = (comparison == "gt" or comparison == "ge") and step < 0;
+    bool reaching = comparison == "ne" and (step == 1 or step == -1);
+    if (not counting and not countingDown and not reaching) {
+        return -1;
+    }
+
+    // ******** Emitting ********** //
+
+    auto emitValue = [&](const string &name, const string &instruction) {
+        string reg = ralloc.getNextReg(name);
+        buffer.emit(reg + " = " + instruction);
+        return reg;
+    };
+    auto emitSlotAddress = [&](int slot) {
+        string address = emitValue("closedFormAddr", "getelementptr i32, i32* " + frameReg + ", i32 " + to_string(slot));
+        int slotBits = loop.slotBits[slot];
+        if (slotBits != 32) {
+            address = emitValue("closedFormAddrCorrect", "bitcast i32* " + address + " to i" + to_string(slotBits) + "*");
+        }
+        return address;
+    };
+    string closedFormLabel = buffer.genLabel("closedForm");
+
+    // The atoms, as they are and widened to i64, in which everything is computed
+    vector<string> atomValues;
+    vector<string> wideAtomValues;
+    for (auto &atom : loop.atoms) {
+        string type = "i" + to_string(atom.bits);
+        string value;
+        if (atom.slot >= 0) {
+            value = emitValue("closedFormStart", "load " + type + ", " + type + "* " + emitSlotAddress(atom.slot));
+        } else if (atom.inner >= 0) {
+            const Atom &inner = loop.atoms[atom.inner];
+            value = emitValue("closedFormCast", atom.name + " i" + to_string(inner.bits) + " " + atomValues[atom.inner] + " to " + type);
+        } else {
+            value = atom.name;
+        }
+        atomValues.push_back(value);
+        wideAtomValues.push_back(atom.bits == 64 ? value : emitValue("closedFormWide", "zext " + type + " " + value + " to i64"));
+    }
+    auto emitScaled = [&](const string &value, uint64_t factor) {
+        return factor == 1 ? value : emitValue("closedFormProduct", "mul i64 " + value + ", " + to_string((int64_t)factor));
+    };
+    auto emitAffine = [&](const Affine &value) {
+        string sum = value.constant == 0 ? "" : to_string((int64_t)value.constant);
+        for (auto &term : value.terms) {
+            if (term.second != 0) {
+                string product = emitScaled(wideAtomValues[term.first], term.second);
+                sum = sum.empty() ? product : emitValue("closedFormSum", "add i64 " + sum + ", " + product);
+            }
+        }
+        return sum.empty() ? "0" : sum;
+    };
+    // value with the wraparound of a bits wide integer
+    auto emitWrap = [&](const string &value, bool isSigned) {
+        if (bits == 64) {
+            return value;
+        }
+        string type = "i" + to_string(bits);
+        string narrow = emitValue("closedFormNarrow", "trunc i64 " + value + " to " + type);
+        return emitValue("closedFormWrapped", string(isSigned ? "sext " : "zext ") + type + " " + narrow + " to i64");
+    };
+
+    // The trip count, and whether the counter stays in range until the condition fails
+    string start = emitWrap(emitAffine(left), isSigned);
+    string bound = emitWrap(emitAffine(right), isSigned);
+    string tripCount;
+    string guard = "true";
+    if (reaching) {
+        tripCount = emitWrap(step == 1 ? emitValue("closedFormDistance", "sub i64 " + bound + ", " + start)
+                                       : emitValue("closedFormDistance", "sub i64 " + start + ", " + bound),
+                             false);
+    } else {
+        bool inclusive = comparison == "le" or comparison == "ge";
+        int64_t stride = counting ? step : -step;
+        string distance = counting ? emitValue("closedFormDistance", "sub i64 " + bound + ", " + start)
+                                   : emitValue("closedFormDistance", "sub i64 " + start + ", " + bound);
+        string enters = emitValue("closedFormEnters", "icmp " + string(inclusive ? "sge" : "sgt") + " i64 " + distance + ", 0");
+        if (inclusive) {
+            tripCount = emitValue("closedFormTrips", "sdiv i64 " + distance + ", " + to_string(stride));
+            tripCount = emitValue("closedFormTrips", "add i64 " + tripCount + ", 1");
+        } else if (stride == 1) {
+            tripCount = distance;
+        } else {
+            string rounded = emitValue("closedFormRounded", "add i64 " + distance + ", " + to_string(stride - 1));
+            tripCount = emitValue("closedFormTrips", "sdiv i64 " + rounded + ", " + to_string(stride));
+        }
+        string travel = emitScaled(tripCount, stride);
+        int64_t limit;
+        string last;
+        string inRange;
+        if (counting) {
+            limit = isSigned ? (int64_t)(getMask(bits) >> 1) : (int64_t)getMask(bits);
+            last = emitValue("closedFormLast", "add i64 " + start + ", " + travel);
+            inRange = emitValue("closedFormInRange", "icmp sle i64 " + last + ", " + to_string(limit));
+        } else {
+            limit = isSigned ? -(int64_t)(getMask(bits) >> 1) - 1 : 0;
+            last = emitValue("closedFormLast", "sub i64 " + start + ", " + travel);
+            inRange = emitValue("closedFormInRange", "icmp sge i64 " + last + ", " + to_string(limit));
+        }
+        guard = emitValue("closedFormApplies", "and i1 " + enters + ", " + inRange);
+    }
+    int guardAddress = buffer.emit("br i1 " + guard + ", label @, label %" + condLabel);
+    buffer.bpatch(make_pair(guardAddress, FIRST), buffer.genLabel("closedFormApply"));
+
+    // The final values
+    string pairs;
+    bool grows = false;
+    for (auto &slope : slopes) {
+        grows = grows or slope.second != 0;
+    }
+    if (grows) {
+        string tripsBefore = emitValue("closedFormTripsBefore", "sub i64 " + tripCount + ", 1");
+        string product = emitValue("closedFormPairs", "mul i64 " + tripCount + ", " + tripsBefore);
+        pairs = emitValue("closedFormPairs", "udiv i64 " + product + ", 2");
+    }
+    for (auto &variable : loop.stored) {
+        int slot = variable.first;
+        int atom = loop.getSlotAtom(slot);
+        string final;
+        if (steps.count(atom)) {
+            final = emitValue("closedFormFinal", "add i64 " + wideAtomValues[atom] + ", " + emitScaled(tripCount, steps[atom]));
+        } else {
+            string total = emitValue("closedFormTotal", "mul i64 " + tripCount + ", " + emitAffine(increments[slot]));
+            final = emitValue("closedFormFinal", "add i64 " + wideAtomValues[atom] + ", " + total);
+            if (slopes[slot] != 0) {
+                final = emitValue("closedFormFinal", "add i64 " + final + ", " + emitScaled(pairs, slopes[slot]));
+            }
+        }
+        string type = "i" + to_string(loop.slotBits[slot]);
+        if (loop.slotBits[slot] != 64) {
+            final = emitValue("closedFormFinalNarrow", "trunc i64 " + final + " to " + type);
+        }
+        buffer.emit("store " + type + " " + final + ", " + type + "* " + emitSlotAddress(slot));
+    }
+    int exitAddress = buffer.emit("br label @");
+
+    // Enter the closed form instead of the loop
+    string entry = buffer.getCodeLine(labelAddress - 1);
+    entry.replace(entry.find("%" + condLabel), condLabel.size() + 1, "%" + closedFormLabel);
+    buffer.replaceCode(labelAddress - 1, labelAddress, {entry});
+    return exitAddress;
+}
+
+// ******** Unrolling ********** //
+
+Unroller::Unroller(int factor, size_t budget) : factor(factor), budget(budget) {}
+
+// The registers and labels line uses
+static vector<string> getNames(const string &line) {
+    vector<string> names;
+    for (size_t sigil = line.find('%'); sigil != string::npos; sigil = line.find('%', sigil + 1)) {
+        size_t end = sigil + 1;
+        while (end < line.size() and isNameChar(line[end])) {
+            end++;
+        }
+        names.push_back(line.substr(sigil, end - sigil));
+    }
+    return names;
+}
+
+static bool isLabel(const string &body) {
+    return not body.empty() and body.back() == ':' and body.find(' ') == string::npos;
+}
+
+// Append a copy of the code from begin up to end to lines, to be put in the code buffer at address, with fresh
+// registers, and labels numbered by their address like genLabel's. names has the new names of the labels the copy
+// branches to instead, and of labels in it that are given one, and gets those of the copy
+static void copyCode(size_t begin, size_t end, size_t address, std::unordered_map<string, string> &names, vector<string> &lines) {
+    auto &buffer = CodeBuffer::instance();
+    auto &ralloc = Ralloc::instance();
+    for (size_t line = begin; line < end; line++) {
+        string body = getBody(buffer.getCodeLine(line));
+        vector<string> words = splitInstruction(body);
+        if (isLabel(body)) {
+            string label = body.substr(0, body.size() - 1);
+            if (not names.count("%" + label)) {
+                countStat(&CompileStats::labels);
+                names["%" + label] = "%" + label.substr(0, label.rfind("label_")) + "label_" + to_string(address + line - begin);
+            }
+        } else if (words.size() > 1 and words[1] == "=") {
+            size_t number = words[0].rfind('_');
+            names[words[0]] = ralloc.getNextReg(number == string::npos ? "" : words[0].substr(1, number - 1));
+        }
+    }
+    for (size_t line = begin; line < end; line++) {
+        string copy = buffer.getCodeLine(line);
+        string body = getBody(copy);
+        if (isLabel(body)) {
+            copy.replace(copy.find(body), body.size() - 1, names["%" + body.substr(0, body.size() - 1)].substr(1));
+        }
+        lines.push_back(substitute(copy, names));
+    }
+}
+
+// How many times a loop goes around when its counter starts at start and adds step, while the counter plus offset
+// compares to bound by predicate, as bits wide integers. Returns false if the loop doesn't stop before the counter
+// wraps around (except for ne, which stops once it is reached either way)
+static bool getTripCount(uint64_t start, int64_t step, uint64_t offset, const string &predicate, uint64_t bound, int bits, uint64_t &tripCount) {
+    uint64_t mask = getMask(bits);
+    if (predicate == "ne") {
+        if (step != 1 and step != -1) {
+            return false;
+        }
+        tripCount = (step == 1 ? bound - (start + offset) : start + offset - bound) & mask;
+        return true;
+    }
+    if (predicate.size() != 3 or (predicate[0] != 's' and predicate[0] != 'u')) {
+        return false;
+    }
+    bool isSigned = predicate[0] == 's';
+    string comparison = predicate.substr(1);
+    auto toValue = [&](uint64_t value) { return isSigned ? (__int128)toSigned(value, bits) : (__int128)(value & mask); };
+    __int128 first = toValue(start + offset);
+    __int128 last = toValue(bound);
+    __int128 max = isSigned ? (__int128)(mask >> 1) : (__int128)mask;
+    __int128 stride = step;
+    // Counting down mirrors counting up, with the minimum as the maximum
+    if (comparison == "gt" or comparison == "ge") {
+        first = -first;
+        last = -last;
+        max = isSigned ? (__int128)(mask >> 1) + 1 : 0;
+        stride = -stride;
+    } else if (comparison != "lt" and comparison != "le") {
+        return false;
+    }
+    // The counter stops below last + 1 for lt, and above it for le
+    if (comparison == "le" or comparison == "ge") {
+        last++;
+    }
+    if (first >= last) {
+        tripCount = 0;
+        return true;
+    }
+    if (stride <= 0) {
+        return false;
+    }
+    __int128 trips = (last - first + stride - 1) / stride;
+    if (first + trips * stride > max) {
+        return false;
+    }
+    tripCount = (uint64_t)trips;
+    return true;
+}
+
+bool Unroller::unrollLoop(const string &condLabel, const string &frameReg, AddressList &falseList, AddressList &breakList) {
+    auto &buffer = CodeBuffer::instance();
+    size_t labelAddress, end;
+    if (not breakList.empty() or falseList.size() != 1 or not findLoop(condLabel, labelAddress, end)) {
+        return false;
+    }
+
+    // The condition compares the counter, plus a constant, to a constant
+    LoopAnalysis condition(frameReg, false);
+    size_t branchAddress = labelAddress + 1;
+    vector<string> words;
+    for (; branchAddress < end; branchAddress++) {
+        string body = getBody(buffer.getCodeLine(branchAddress));
+        if (body.empty() or body[0] == ';') {
+            continue;
+        }
+        words = splitInstruction(body);
+        if (words.size() == 7 and words[0] == "br" and words[1] == "i1" and words[6] == "@") {
+            break;
+        }
+        if (not condition.step(body)) {
+            return false;
+        }
+    }
+    size_t bodyAddress = branchAddress + 1;
+    string bodyLabel = words.size() == 7 ? words[4] : "";
+    Affine left, right;
+    string predicate;
+    int bits;
+    if (bodyAddress >= end or (int)branchAddress != falseList[0].first or not condition.stored.empty() or
+        getBody(buffer.getCodeLine(bodyAddress)) != bodyLabel.substr(1) + ":" or
+        not condition.getCondition(words[2], left, right, predicate, bits)) {
+        return false;
+    }
+    auto isCounter = [&](const Affine &value) {
+        int terms = 0;
+        for (auto &term : value.terms) {
+            if ((term.second & getMask(bits)) != 0) {
+                const Atom &atom = condition.atoms[term.first];
+                if ((term.second & getMask(bits)) != 1 or atom.slot < 0 or atom.inner >= 0 or atom.bits != bits) {
+                    return false;
+                }
+                terms++;
+            }
+        }
+        return terms == 1;
+    };
+    if (not isCounter(left) or not right.terms.empty()) {
+        static const std::map<string, string> swapped = {{"slt", "sgt"}, {"sle", "sge"}, {"sgt", "slt"}, {"sge", "sle"},
+                                                         {"ult", "ugt"}, {"ule", "uge"}, {"ugt", "ult"}, {"uge", "ule"},
+                                                         {"ne", "ne"}};
+        auto found = swapped.find(predicate);
+        if (not isCounter(right) or not left.terms.empty() or found == swapped.end()) {
+            return false;
+        }
+        std::swap(left, right);
+        predicate = found->second;
+    }
+    int slot = -1;
+    for (auto &term : left.terms) {
+        if ((term.second & getMask(bits)) != 0) {
+            slot = condition.atoms[term.first].slot;
+        }
+    }
+
+    // The body has no other way back to the condition or out of the loop, and doesn't use the condition's registers
+    std::set<string> conditionNames;
+    for (size_t address = labelAddress + 1; address < branchAddress; address++) {
+        words = splitInstruction(getBody(buffer.getCodeLine(address)));
+        if (words.size() > 1 and words[1] == "=") {
+            conditionNames.insert(words[0]);
+        }
+    }
+    conditionNames.insert("%" + condLabel);
+    size_t lastBlockAddress = bodyAddress;
+    for (size_t address = bodyAddress; address < end; address++) {
+        string body = getBody(buffer.getCodeLine(address));
+        if (body.find("label @") != string::npos) {
+            return false;
+        }
+        for (auto &name : getNames(body)) {
+            if (conditionNames.count(name)) {
+                return false;
+            }
+        }
+        if (isLabel(body)) {
+            lastBlockAddress = address;
+        }
+    }
+
+    // Only the last block of the body, which every iteration ends with, changes the counter, by adding a constant
+    LoopAnalysis body(frameReg, true);
+    for (size_t address = bodyAddress + 1; address < end; address++) {
+        if (address == lastBlockAddress and (body.stored.count(slot) or body.clobbered.count(slot))) {
+            return false;
+        }
+        if (not body.step(getBody(buffer.getCodeLine(address)))) {
+            return false;
+        }
+    }
+    auto update = body.stored.find(slot);
+    if (update == body.stored.end() or body.slotBits[slot] != bits) {
+        return false;
+    }
+    int counter = body.getSlotAtom(slot);
+    for (auto &term : update->second.terms) {
+        if ((term.second & getMask(bits)) != (term.first == counter ? 1 : 0)) {
+            return false;
+        }
+    }
+    int64_t step = toSigned(update->second.constant, bits);
+
+    // The counter starts at a constant stored to it right before the loop
+    size_t preheaderAddress = labelAddress - 1;
+    while (preheaderAddress > 0 and not isLabel(getBody(buffer.getCodeLine(preheaderAddress - 1))) and
+           getBody(buffer.getCodeLine(preheaderAddress - 1)).compare(0, 7, "define ") != 0) {
+        preheaderAddress--;
+    }
+    LoopAnalysis preheader(frameReg, true);
+    for (size_t address = preheaderAddress; address < labelAddress - 1; address++) {
+        if (not preheader.step(getBody(buffer.getCodeLine(address)))) {
+            return false;
+        }
+    }
+    auto start = preheader.stored.find(slot);
+    uint64_t tripCount;
+    if (start == preheader.stored.end() or not start->second.terms.empty() or preheader.slotBits[slot] != bits or
+        not getTripCount(start->second.constant, step, left.constant, predicate, right.constant, bits, tripCount) or
+        tripCount == 0) {
+        return false;
+    }
+
+    // Fully unroll the loop if all its copies fit in the budget, or else go around the loop less often with factor
+    // copies in it, after the copies of the iterations left over
+    size_t copyLines = end - bodyAddress + 1;
+    size_t copies, leftOver;
+    bool full = tripCount <= this->budget / copyLines;
+    if (full) {
+        copies = tripCount;
+        leftOver = tripCount;
+    } else if (this->factor > 1 and tripCount >= (uint64_t)this->factor and
+               (this->factor + tripCount % this->factor) * copyLines <= this->budget) {
+        copies = this->factor;
+        leftOver = tripCount % this->factor;
+    } else {
+        countStat(&CompileStats::loopsOverUnrollBudget);
+        return false;
+    }
+
+    // ******** Emitting ********** //
+
+    vector<string> lines;
+    lines.push_back(buffer.getCodeLine(labelAddress - 1));
+    // Where each copy of the body starts, in the code buffer once the loop is replaced
+    vector<int> copyAddresses;
+    auto emitCopy = [&](const string &next) {
+        std::unordered_map<string, string> names = {{"%" + condLabel, next}};
+        copyAddresses.push_back(labelAddress - 1 + lines.size());
+        copyCode(bodyAddress, end + 1, labelAddress - 1 + lines.size(), names, lines);
+        countStat(&CompileStats::unrolledCopies);
+    };
+    // The label of the copy emitted next
+    auto nextCopy = [&](size_t extraLines) {
+        string label = getBody(buffer.getCodeLine(bodyAddress));
+        return "%" + label.substr(0, label.rfind("label_")) + "label_" + to_string(labelAddress - 1 + lines.size() + extraLines);
+    };
+
+    if (leftOver > 0) {
+        lines[0] = substitute(lines[0], {{"%" + condLabel, nextCopy(0)}});
+    }
+    for (size_t i = 0; i < leftOver; i++) {
+        emitCopy(i + 1 < leftOver ? nextCopy(copyLines) : full ? "@" : "%" + condLabel);
+    }
+    int exitAddress = labelAddress - 1 + lines.size() - 1;
+    if (full) {
+        countStat(&CompileStats::unrolledLoops);
+        falseList.clear();
+        breakList.push_back(make_pair(exitAddress, FIRST));
+    } else {
+        countStat(&CompileStats::partiallyUnrolledLoops);
+        for (size_t address = labelAddress; address <= branchAddress; address++) {
+            lines.push_back(buffer.getCodeLine(address));
+        }
+        falseList[0].first = labelAddress - 1 + lines.size() - 1;
+        lines.back() = substitute(lines.back(), {{bodyLabel, nextCopy(0)}});
+        for (size_t i = 0; i < copies; i++) {
+            emitCopy(i + 1 < copies ? nextCopy(copyLines) : "%" + condLabel);
+        }
+    }
+    buffer.replaceCode(labelAddress - 1, end + 1, lines);
+    SymbolTable::instance().moveReturnGuards(bodyAddress, end + 1, copyAddresses);
+    return true;
+}
+
+// ******** Rotation ********** //
+
+void rotateLoop(const string &condLabel, const string &bodyLabel, AddressList &falseList) {
+    auto &buffer = CodeBuffer::instance();
+    size_t end = buffer.getCodeSize() - 1;
+    if (getBody(buffer.getCodeLine(end)) != "br label %" + condLabel) {
+        return;
+    }
+    size_t bodyAddress = end;
+    while (bodyAddress > 0 and getBody(buffer.getCodeLine(bodyAddress)) != bodyLabel + ":") {
+        bodyAddress--;
+    }
+    size_t labelAddress = bodyAddress;
+    while (labelAddress > 0 and bodyAddress - labelAddress < MAX_ROTATED_CONDITION_LINES and
+           getBody(buffer.getCodeLine(labelAddress)) != condLabel + ":") {
+        labelAddress--;
+    }
+    if (getBody(buffer.getCodeLine(labelAddress)) != condLabel + ":" or labelAddress == bodyAddress) {
+        return;
+    }
+
+    // The condition only leaves the loop through falseList, and the body doesn't use its registers, which the copy
+    // doesn't define on the way from the entry
+    size_t exits = 0;
+    std::set<string> conditionRegisters;
+    for (size_t address = labelAddress + 1; address < bodyAddress; address++) {
+        string body = getBody(buffer.getCodeLine(address));
+        vector<string> words = splitInstruction(body);
+        if (words.size() > 1 and words[1] == "=") {
+            conditionRegisters.insert(words[0]);
+        }
+        if (body.find("label @") != string::npos) {
+            exits++;
+        }
+    }
+    for (auto &exit : falseList) {
+        if (exit.first < (int)labelAddress or exit.first >= (int)bodyAddress) {
+            return;
+        }
+    }
+    if (exits != falseList.size()) {
+        return;
+    }
+    vector<size_t> backEdges;
+    for (size_t address = bodyAddress; address <= end; address++) {
+        for (auto &name : getNames(buffer.getCodeLine(address))) {
+            if (conditionRegisters.count(name)) {
+                return;
+            }
+            if (name == "%" + condLabel) {
+                backEdges.push_back(address);
+            }
+        }
+    }
+
+    // The copy of the condition at the bottom is the loop's back edge, and where continue goes
+    size_t latchAddress = buffer.getCodeSize();
+    string latchLabel = "%loopLatch_label_" + to_string(latchAddress);
+    std::unordered_map<string, string> names = {{"%" + condLabel, latchLabel}};
+    vector<string> latch;
+    copyCode(labelAddress, bodyAddress, latchAddress, names, latch);
+    for (size_t address : backEdges) {
+        buffer.replaceCode(address, address + 1, {substitute(buffer.getCodeLine(address), {{"%" + condLabel, latchLabel}})});
+    }
+    size_t exitCount = falseList.size();
+    for (size_t i = 0; i < exitCount; i++) {
+        falseList.push_back(make_pair(falseList[i].first - labelAddress + latchAddress, falseList[i].second));
+    }
+    for (auto &line : latch) {
+        buffer.emitVerbatim(line);
+    }
+    countStat(&CompileStats::rotatedLoops);
+}
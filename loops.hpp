@@ -0,0 +1,44 @@
+#ifndef LOOPS_H_
+#define LOOPS_H_
+
+#include <cstddef>
+#include <string>
+
+#include "bp.hpp"
+
+// Replace the while loop just lowered, from the label condLabel starting its condition up to the branch back to it, by
+// its effect in closed form. A loop whose body only adds constants to its counters (induction variables) and adds
+// affine functions of the counters and of values it doesn't change to its accumulators, and whose condition compares
+// a counter to such a value, computes its trip count and stores the final values of the variables in
+// frameReg's frame, with the wraparound of their type. Entering the loop then goes to the closed form, which falls
+// back to the loop when its counter would wrap around before the condition fails. Returns the address of the closed
+// form's branch to the end of the loop, to be backpatched like a break, or -1 if the loop isn't one of these
+int emitClosedForm(const std::string &condLabel, const std::string &frameReg);
+
+// Loop unrolling for --unroll. A while loop without break or continue whose condition compares a counter to a constant,
+// whose counter starts at a constant and is only changed by adding a constant at the end of the body, goes around a
+// number of times known at compile time. If that many copies of the body fit in the budget of lines, the loop is
+// replaced by them. Otherwise the body is copied factor times inside the loop, so the condition is checked once for
+// every factor iterations, after copies of the iterations left over. Loops that would go past the budget either way
+// are left alone
+class Unroller {
+    int factor;
+    size_t budget;
+
+   public:
+    Unroller(int factor, size_t budget);
+    Unroller(const Unroller &) = delete;
+    void operator=(const Unroller &) = delete;
+    // Unroll the loop just lowered, from the label condLabel to the branch back to it, if it is one of these. Its exit
+    // is then taken from falseList, the condition's branch out of the loop, or added to breakList. Returns whether it
+    // was unrolled
+    bool unrollLoop(const std::string &condLabel, const std::string &frameReg, AddressList &falseList, AddressList &breakList);
+};
+
+// Rotate the while loop just lowered, from the label condLabel to the branch back to it, into a do-while loop guarded
+// by its condition: the branches back to the condition, from the end of the body at bodyLabel and from continue
+// statements, go to a copy of the condition at the bottom instead, whose branches out of the loop are added to
+// falseList. Each iteration then takes one branch instead of going back to the top and then into the body
+void rotateLoop(const std::string &condLabel, const std::string &bodyLabel, AddressList &falseList);
+
+#endif
@@ -0,0 +1,121 @@
+#include "memo.hpp"
+
+#include <string>
+#include <vector>
+
+#include "bp.hpp"
+#include "ralloc.hpp"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+// Entries in each table. Colliding calls just replace each other's results
+static const int MEMO_TABLE_SIZE = 4096;
+
+bool Memoizer::shouldMemoize(const FuncIdC &funcId, int effects, bool recurses) const {
+    // Filling the table would change the counts of --profile, so anything writing globals is left alone
+    return recurses and not(effects & (PRINTS | WRITES_GLOBALS)) and funcId.getType() != TypeName::VOID and
+           not funcId.getArgTypes().empty();
+}
+
+void Memoizer::emitWrapper(const FuncIdC &funcId, int definitionAddress) {
+    auto &buffer = CodeBuffer::instance();
+    auto &ralloc = Ralloc::instance();
+    const string &name = funcId.getName();
+    const vector<TypeName> &argTypes = funcId.getArgTypes();
+    const string retType = typeNameToLlvmType(funcId.getType());
+    buffer.setFunctionName(definitionAddress, name + ".compute");
+
+    // An entry is whether it is filled, the arguments, and the result
+    string entryType = "{ i1";
+    for (TypeName argType : argTypes) {
+        entryType += ", " + typeNameToLlvmType(argType);
+    }
+    entryType += ", " + retType + " }";
+    const string tableType = "[" + to_string(MEMO_TABLE_SIZE) + " x " + entryType + "]";
+    const string table = "@" + name + ".memo";
+    buffer.emitGlobal(table + " = internal global " + tableType + " zeroinitializer");
+
+    vector<string> args;
+    string formals;
+    for (TypeName argType : argTypes) {
+        args.push_back(typeNameToLlvmType(argType) + " " + ralloc.getNextReg("memoArg"));
+        formals += (formals.empty() ? "" : ", ") + args.back();
+    }
+    buffer.emit("define internal fastcc " + retType + " @" + name + "(" + formals + ") nounwind {");
+
+    // FNV-1a over the arguments, with the high bits folded into the low ones the index is taken from
+    string hashReg = "-2128831035";
+    for (size_t i = 0; i < argTypes.size(); i++) {
+        string argReg = args[i].substr(args[i].find(' ') + 1);
+        if (argTypes[i] != TypeName::INT) {
+            string extendedReg = ralloc.getNextReg("memoExtendedArg");
+            buffer.emit("\t" + extendedReg + " = zext " + args[i] + " to i32");
+            argReg = extendedReg;
+        }
+        string mixedReg = ralloc.getNextReg("memoMixed");
+        string nextHashReg = ralloc.getNextReg("memoHash");
+        buffer.emit("\t" + mixedReg + " = xor i32 " + hashReg + ", " + argReg);
+        buffer.emit("\t" + nextHashReg + " = mul i32 " + mixedReg + ", 16777619");
+        hashReg = nextHashReg;
+    }
+    string highBitsReg = ralloc.getNextReg("memoHighBits");
+    string foldedReg = ralloc.getNextReg("memoFolded");
+    string indexReg = ralloc.getNextReg("memoIndex");
+    string entryReg = ralloc.getNextReg("memoEntry");
+    buffer.emit("\t" + highBitsReg + " = lshr i32 " + hashReg + ", 16");
+    buffer.emit("\t" + foldedReg + " = xor i32 " + hashReg + ", " + highBitsReg);
+    buffer.emit("\t" + indexReg + " = and i32 " + foldedReg + ", " + to_string(MEMO_TABLE_SIZE - 1));
+    buffer.emit("\t" + entryReg + " = getelementptr " + tableType + ", " + tableType + "* " + table + ", i32 0, i32 " + indexReg);
+    // Pointers to the fields of the entry, by their index in it
+    vector<string> fieldPtrRegs;
+    for (size_t i = 0; i < argTypes.size() + 2; i++) {
+        fieldPtrRegs.push_back(ralloc.getNextReg("memoFieldPtr"));
+        buffer.emit("\t" + fieldPtrRegs[i] + " = getelementptr " + entryType + ", " + entryType + "* " + entryReg + ", i32 0, i32 " + to_string(i));
+    }
+    string filledReg = ralloc.getNextReg("memoFilled");
+    buffer.emit("\t" + filledReg + " = load i1, i1* " + fieldPtrRegs[0]);
+    int filledBranch = buffer.emit("\tbr i1 " + filledReg + ", label @, label @");
+
+    // A filled entry is a hit if it has the same arguments
+    buffer.bpatch(make_pair(filledBranch, FIRST), buffer.genLabel("memoCompare"));
+    string sameReg;
+    for (size_t i = 0; i < argTypes.size(); i++) {
+        string type = typeNameToLlvmType(argTypes[i]);
+        string argReg = args[i].substr(args[i].find(' ') + 1);
+        string cachedArgReg = ralloc.getNextReg("memoCachedArg");
+        string equalReg = ralloc.getNextReg("memoArgEqual");
+        buffer.emit("\t" + cachedArgReg + " = load " + type + ", " + type + "* " + fieldPtrRegs[i + 1]);
+        buffer.emit("\t" + equalReg + " = icmp eq " + type + " " + cachedArgReg + ", " + argReg);
+        if (sameReg.empty()) {
+            sameReg = equalReg;
+        } else {
+            string bothReg = ralloc.getNextReg("memoSame");
+            buffer.emit("\t" + bothReg + " = and i1 " + sameReg + ", " + equalReg);
+            sameReg = bothReg;
+        }
+    }
+    const string &resultPtrReg = fieldPtrRegs.back();
+    int sameBranch = buffer.emit("\tbr i1 " + sameReg + ", label @, label @");
+
+    buffer.bpatch(make_pair(sameBranch, FIRST), buffer.genLabel("memoHit"));
+    string cachedResultReg = ralloc.getNextReg("memoCachedResult");
+    buffer.emit("\t" + cachedResultReg + " = load " + retType + ", " + retType + "* " + resultPtrReg);
+    buffer.emit("\tret " + retType + " " + cachedResultReg);
+
+    string missLabel = buffer.genLabel("memoMiss");
+    buffer.bpatch(make_pair(filledBranch, SECOND), missLabel);
+    buffer.bpatch(make_pair(sameBranch, SECOND), missLabel);
+    string resultReg = ralloc.getNextReg("memoResult");
+    buffer.emit("\t" + resultReg + " = call fastcc " + retType + " @" + name + ".compute(" + formals + ")");
+    buffer.emit("\tstore i1 1, i1* " + fieldPtrRegs[0]);
+    for (size_t i = 0; i < argTypes.size(); i++) {
+        buffer.emit("\tstore " + args[i] + ", " + typeNameToLlvmType(argTypes[i]) + "* " + fieldPtrRegs[i + 1]);
+    }
+    buffer.emit("\tstore " + retType + " " + resultReg + ", " + retType + "* " + resultPtrReg);
+    buffer.emit("\tret " + retType + " " + resultReg);
+    // To balance rainbow brackets {
+    buffer.emit("}");
+    buffer.emit("");
+}
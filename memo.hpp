@@ -0,0 +1,24 @@
+#ifndef MEMO_H_
+#define MEMO_H_
+
+#include <memory>
+
+#include "stypes.hpp"
+
+// Memoization of pure recursive functions for --memoize. A function that doesn't print and has parameters and a result
+// is renamed to NAME.compute once it is lowered, and NAME becomes a wrapper that looks its arguments up in a direct
+// mapped table of past results, and calls NAME.compute and fills the table on a miss. Its recursive calls go through
+// the wrapper too, so a kernel like fibo makes a linear number of calls instead of an exponential one. Calls that exit
+// on a division by zero or run forever never fill the table, so the output is the same
+class Memoizer {
+   public:
+    Memoizer() = default;
+    Memoizer(const Memoizer &) = delete;
+    void operator=(const Memoizer &) = delete;
+    // Whether to memoize the function just lowered, given its FunctionEffect flags and whether it calls itself
+    bool shouldMemoize(const FuncIdC &funcId, int effects, bool recurses) const;
+    // Rename the function defined at definitionAddress, and emit its wrapper after it
+    void emitWrapper(const FuncIdC &funcId, int definitionAddress);
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include "native.hpp"
+
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "compilation.hpp"
+#include "io.hpp"
+
+using std::string;
+using std::vector;
+
+extern char **environ;
+
+// A file created with a unique name, and removed when this is destroyed unless it is kept
+class TemporaryFile {
+    string path;
+
+   public:
+    TemporaryFile(const string &directory, const string &suffix) : path(directory + "/hw5-XXXXXX" + suffix) {
+        int fd = mkstemps(&this->path[0], suffix.size());
+        if (fd == -1) {
+            this->path.clear();
+        } else {
+            close(fd);
+        }
+    }
+    TemporaryFile(const TemporaryFile &) = delete;
+    void operator=(const TemporaryFile &) = delete;
+    ~TemporaryFile() {
+        if (not this->path.empty()) {
+            unlink(this->path.c_str());
+        }
+    }
+    // Empty if the file couldn't be created
+    const string &getPath() const {
+        return this->path;
+    }
+    // Move the file to path instead of removing it. Returns false (with errno set) on failure
+    bool keepAs(const string &path) {
+        if (rename(this->path.c_str(), path.c_str()) != 0) {
+            return false;
+        }
+        this->path.clear();
+        return true;
+    }
+};
+
+static string getTool(const char *variable, const char *name) {
+    const char *tool = getenv(variable);
+    return tool and *tool ? tool : name;
+}
+
+void emitNativeEntry(CodeBuffer &buffer) {
+    for (size_t i = 0; i < buffer.getCodeSize(); i++) {
+        const string &line = buffer.getCodeLine(i);
+        if (line.compare(0, 7, "define ") == 0 and line.find(" @main(") != string::npos) {
+            buffer.setFunctionName(i, "main.fanc");
+            break;
+        }
+    }
+    buffer.emitVerbatim("define i32 @main() {");
+    buffer.emitVerbatim("\tcall void @main.fanc()");
+    buffer.emitVerbatim("\tret i32 0");
+    buffer.emitVerbatim("}");
+}
+
+string getTemporaryDirectory() {
+    const char *directory = getenv("TMPDIR");
+    return directory and *directory ? directory : "/tmp";
+}
+
+static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Run a tool to completion, adding its run time to seconds. Returns false if it couldn't be run or failed
+static bool runTool(const vector<string> &args, double &seconds) {
+    vector<char *> argv;
+    for (auto &arg : args) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    double start = now();
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+    if (error != 0) {
+        reportError(args[0] + ": " + strerror(error));
+        return false;
+    }
+    int status;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            reportError(args[0] + ": " + strerror(errno));
+            return false;
+        }
+    }
+    seconds += now() - start;
+
+    if (not WIFEXITED(status) or WEXITSTATUS(status) != 0) {
+        reportError(args[0] + " failed");
+        return false;
+    }
+    return true;
+}
+
+// Where the object optimized from the IR at irPath is cached, or "" if the IR can't be read. Objects are looked up by
+// a 64 bit FNV-1a hash of the IR, and of everything else that goes into them
+static string getCachedObjectPath(const string &directory, const string &irPath, int optimizationLevel, const string &llc) {
+    SourceFile ir;
+    if (not ir.open(irPath.c_str())) {
+        return "";
+    }
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto add = [&hash](const char *data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+        }
+    };
+    string settings = "-O" + std::to_string(optimizationLevel) + " " + llc;
+    add(settings.c_str(), settings.size() + 1);
+    add(ir.getSource(), ir.getSourceSize());
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.o", (unsigned long long)hash);
+    return directory + "/" + name;
+}
+
+bool NativeBuild::build(const string &irPath, const char *outputPath, const string &sourceName) const {
+    const string opt = getTool("HW5_OPT", "opt");
+    const string llc = getTool("HW5_LLC", "llc");
+    const string cc = getTool("HW5_CC", "cc");
+    const string level = "-O" + std::to_string(this->optimizationLevel);
+    double optSeconds = 0;
+    double llcSeconds = 0;
+    double linkSeconds = 0;
+
+    string objectPath;
+    if (this->cacheDirectory) {
+        objectPath = getCachedObjectPath(this->cacheDirectory, irPath, this->optimizationLevel, llc);
+        if (mkdir(this->cacheDirectory, 0777) != 0 and errno != EEXIST) {
+            reportError(string(this->cacheDirectory) + ": " + strerror(errno));
+            objectPath.clear();
+        }
+    }
+    const bool cached = not objectPath.empty() and access(objectPath.c_str(), R_OK) == 0;
+
+    if (not cached) {
+        // A cached object is written next to where it goes and renamed there, so a concurrent build never links a
+        // partial one
+        TemporaryFile object(objectPath.empty() ? getTemporaryDirectory() : this->cacheDirectory, ".o");
+        TemporaryFile optimized(getTemporaryDirectory(), ".bc");
+        if (object.getPath().empty() or optimized.getPath().empty()) {
+            reportError(string("creating temporary file: ") + strerror(errno));
+            return false;
+        }
+
+        string input = irPath;
+        if (this->optimizationLevel > 0) {
+            if (not runTool({opt, level, irPath, "-o", optimized.getPath()}, optSeconds)) {
+                return false;
+            }
+            input = optimized.getPath();
+        }
+        if (not runTool({llc, level, "-filetype=obj", "-relocation-model=pic", input, "-o", object.getPath()}, llcSeconds)) {
+            return false;
+        }
+
+        if (objectPath.empty()) {
+            if (not runTool({cc, object.getPath(), "-o", outputPath}, linkSeconds)) {
+                return false;
+            }
+        } else if (not object.keepAs(objectPath)) {
+            reportError(objectPath + ": " + strerror(errno));
+            return false;
+        }
+    }
+    if (not objectPath.empty() and not runTool({cc, objectPath, "-o", outputPath}, linkSeconds)) {
+        return false;
+    }
+
+    char line[256];
+    if (this->statsFormat == StatsFormat::JSON) {
+        snprintf(line, sizeof(line), ", \"native\": {\"optMs\": %.3f, \"llcMs\": %.3f, \"linkMs\": %.3f, \"cachedObject\": %s}}\n",
+                 optSeconds * 1000, llcSeconds * 1000, linkSeconds * 1000, cached ? "true" : "false");
+        std::cerr << "{\"source\": " + quoteJson(sourceName) + line;
+    } else if (this->statsFormat == StatsFormat::TEXT) {
+        string report = "native build of " + sourceName + (cached ? " (cached object):\n" : ":\n");
+        snprintf(line, sizeof(line), "  %-10s %10.3f\n  %-10s %10.3f\n  %-10s %10.3f\n  %-10s %10.3f\n", "opt",
+                 optSeconds * 1000, "llc", llcSeconds * 1000, "link", linkSeconds * 1000, "total",
+                 (optSeconds + llcSeconds + linkSeconds) * 1000);
+        std::cerr << report + line;
+    }
+    return true;
+}
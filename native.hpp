@@ -0,0 +1,32 @@
+#ifndef NATIVE_H_
+#define NATIVE_H_
+
+#include <string>
+
+#include "bp.hpp"
+#include "stats.hpp"
+
+// Building a native executable from a program's IR with the local LLVM tools and C compiler: opt runs the pass
+// pipeline, llc lowers the result to an object, and cc links it against the C library the runtime calls into. The
+// tools are run as found on PATH, unless overridden by $HW5_OPT, $HW5_LLC and $HW5_CC
+struct NativeBuild {
+    // -O level of opt and llc. At 0 opt is skipped
+    int optimizationLevel;
+    // Directory to cache objects in by their IR, or null to always run opt and llc
+    const char *cacheDirectory;
+    // Report how long each stage took to stderr, and in what format
+    StatsFormat statsFormat;
+
+    // Build the executable outputPath from the IR at irPath. Tool failures are reported to stderr. Returns false if
+    // the build failed
+    bool build(const std::string &irPath, const char *outputPath, const std::string &sourceName) const;
+};
+
+// FanC's main is void, but the C library runs main as int main() and exits with what it returns. Rename the program's
+// main in buffer to main.fanc, and add a main that calls it and returns 0
+void emitNativeEntry(CodeBuffer &buffer);
+
+// $TMPDIR, or /tmp
+std::string getTemporaryDirectory();
+
+#endif
@@ -0,0 +1,131 @@
+#include "profile.hpp"
+
+#include <map>
+
+#include "bp.hpp"
+#include "ralloc.hpp"
+#include "tokens.hpp"
+
+using std::map;
+using std::string;
+using std::to_string;
+using std::vector;
+
+Profile::Profile() : counters(), functions(), inMain(false) {}
+
+static string getCounterName(size_t counter) {
+    return "@.profile_count_" + to_string(counter);
+}
+
+void Profile::count(Kind kind, int line) {
+    auto &buffer = CodeBuffer::instance();
+    auto &ralloc = Ralloc::instance();
+    string counter = getCounterName(this->counters.size());
+    string countReg = ralloc.getNextReg("profileCount");
+    string nextCountReg = ralloc.getNextReg("profileNextCount");
+
+    this->counters.push_back({kind, line, this->functions.size() - 1});
+    buffer.emit(countReg + " = load i64, i64* " + counter);
+    buffer.emit(nextCountReg + " = add i64 " + countReg + ", 1");
+    buffer.emit("store i64 " + nextCountReg + ", i64* " + counter);
+}
+
+void Profile::startFunction(const string &name) {
+    this->functions.push_back(name);
+    this->inMain = name == "main";
+    this->count(Kind::CALL, yylineno);
+}
+
+void Profile::countBlock() {
+    this->count(Kind::BLOCK, yylineno);
+}
+
+void Profile::countLoopIteration(int loopLine) {
+    this->count(Kind::LOOP, loopLine);
+}
+
+void Profile::beforeReturn() {
+    if (this->inMain) {
+        this->beforeExit();
+    }
+}
+
+void Profile::beforeExit() {
+    CodeBuffer::instance().emit("call void @.profile_report()");
+}
+
+// Emit text as a global string constant called name, and return a pointer to it to pass to a call
+static string emitString(CodeBuffer &buffer, const string &name, const string &text) {
+    string escaped;
+    for (char c : text) {
+        escaped += c == '\n' ? string("\\0A") : string(1, c);
+    }
+    string arrayType = "[" + to_string(text.size() + 1) + " x i8]";
+    buffer.emitGlobal(name + " = constant " + arrayType + " c\"" + escaped + "\\00\"");
+    return "i8* getelementptr (" + arrayType + ", " + arrayType + "* " + name + ", i32 0, i32 0)";
+}
+
+// Emit the sum of counters into the report function, and return the register holding it
+static string emitSum(CodeBuffer &buffer, const vector<size_t> &counters, int &nextReg) {
+    string sumReg;
+    for (size_t counter : counters) {
+        string countReg = "%count_" + to_string(nextReg++);
+        buffer.emitGlobal("\t" + countReg + " = load i64, i64* " + getCounterName(counter));
+        if (sumReg.empty()) {
+            sumReg = countReg;
+        } else {
+            string addedReg = "%sum_" + to_string(nextReg++);
+            buffer.emitGlobal("\t" + addedReg + " = add i64 " + sumReg + ", " + countReg);
+            sumReg = addedReg;
+        }
+    }
+    return sumReg;
+}
+
+void Profile::finish() {
+    auto &buffer = CodeBuffer::instance();
+    for (size_t counter = 0; counter < this->counters.size(); counter++) {
+        buffer.emitGlobal(getCounterName(counter) + " = global i64 0");
+    }
+
+    vector<string> functionNames;
+    for (size_t function = 0; function < this->functions.size(); function++) {
+        functionNames.push_back(emitString(buffer, "@.profile_function_" + to_string(function), this->functions[function]));
+    }
+    string callsFormat = emitString(buffer, "@.profile_calls_format", "%12ld calls of %s\n");
+    string lineFormat = emitString(buffer, "@.profile_line_format", "%12ld hits of line %d in %s\n");
+    string loopFormat = emitString(buffer, "@.profile_loop_format", "%12ld iterations of the loop at line %d in %s\n");
+
+    // A line's hits are the runs of the blocks starting on it, including function entries
+    vector<vector<size_t>> calls(this->functions.size());
+    map<int, vector<size_t>> lines;
+    map<int, vector<size_t>> loops;
+    for (size_t counter = 0; counter < this->counters.size(); counter++) {
+        const Counter &c = this->counters[counter];
+        if (c.kind == Kind::CALL) {
+            calls[c.function].push_back(counter);
+        }
+        (c.kind == Kind::LOOP ? loops : lines)[c.line].push_back(counter);
+    }
+
+    buffer.emitGlobal("declare i32 @dprintf(i32, i8*, ...)");
+    buffer.emitGlobal("define void @.profile_report() {");
+    int nextReg = 0;
+    auto emitReport = [&](const string &format, const vector<size_t> &counters, const string &args) {
+        string sumReg = emitSum(buffer, counters, nextReg);
+        buffer.emitGlobal("\tcall i32 (i32, i8*, ...) @dprintf(i32 2, " + format + ", i64 " + sumReg + args + ")");
+    };
+    for (size_t function = 0; function < this->functions.size(); function++) {
+        emitReport(callsFormat, calls[function], ", " + functionNames[function]);
+    }
+    for (auto &line : lines) {
+        string function = functionNames[this->counters[line.second.front()].function];
+        emitReport(lineFormat, line.second, ", i32 " + to_string(line.first) + ", " + function);
+    }
+    for (auto &loop : loops) {
+        string function = functionNames[this->counters[loop.second.front()].function];
+        emitReport(loopFormat, loop.second, ", i32 " + to_string(loop.first) + ", " + function);
+    }
+    buffer.emitGlobal("\tret void");
+    buffer.emitGlobal("}");
+}
@@ -0,0 +1,44 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <string>
+#include <vector>
+
+// Counters compiled into the program by --profile, each counting how often a spot in it runs, tagged with its FanC
+// line. The program writes a report of them to stderr when main returns or it exits on a division by zero, so its
+// output is the same as without profiling
+class Profile {
+    enum class Kind { BLOCK, CALL, LOOP };
+
+    struct Counter {
+        Kind kind;
+        int line;
+        // Index in functions
+        size_t function;
+    };
+
+    std::vector<Counter> counters;
+    std::vector<std::string> functions;
+    bool inMain;
+
+    void count(Kind kind, int line);
+
+   public:
+    Profile();
+    Profile(const Profile &) = delete;
+    void operator=(const Profile &) = delete;
+    // Count the calls of the function whose body is starting
+    void startFunction(const std::string &name);
+    // Count the executions of the basic block starting at the current line
+    void countBlock();
+    // Count the iterations of the loop starting at loopLine, on a back edge of it
+    void countLoopIteration(int loopLine);
+    // Write the report if main is about to return
+    void beforeReturn();
+    // Write the report before the program exits
+    void beforeExit();
+    // Emit the counters and the function writing the report of them
+    void finish();
+};
+
+#endif
@@ -1,19 +1,26 @@
 #include "ralloc.hpp"
+
+#include "compilation.hpp"
+#include "stats.hpp"
+
 using std::string;
 
 Ralloc::Ralloc() : nextReg(1) {}
 
-// Get the singleton object instance
 Ralloc &Ralloc::instance() {
-    static Ralloc instance;
-    return instance;
+    return Compilation::current().ralloc;
 }
 
 // Get the next register
 string Ralloc::getNextReg(const string &prefix) {
+    countStat(&CompileStats::registers);
     return "%" + prefix + (prefix == "" ? "" : "_") + std::to_string(nextReg++);
 }
 
-string Ralloc::getNextVarName() {
-    return "@." + std::to_string(nextReg++);
+int Ralloc::peekNextNumber() const {
+    return nextReg;
+}
+
+void Ralloc::skipNumbers(int count) {
+    nextReg += count;
 }
@@ -5,6 +5,8 @@
 
 // Singleton class for dynamically allocating LLVM registers to be used by the code synthesizer
 class Ralloc {
+    friend class Compilation;
+
    private:
     int nextReg;
     // Constructor
@@ -12,12 +14,14 @@ class Ralloc {
     Ralloc(const Ralloc &) = delete;
 
    public:
-    // Get the singleton instance
+    // The register allocator of the current compilation
     static Ralloc &instance();
     // Get the next available register
     std::string getNextReg(const std::string &prefix = "reg");
-    // Get the next available variable name
-    std::string getNextVarName();
+    // Number that the next register will get
+    int peekNextNumber() const;
+    // Skip count numbers, as if that many registers were allocated
+    void skipNumbers(int count);
 };
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@ set -e
 
 
 python3 ./compile_and_run.py
+python3 ./check_options.py
 
 
 # # For each file in hw5_tests, run the test and print the result
@@ -0,0 +1,155 @@
+#include "server.hpp"
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "compilation.hpp"
+#include "io.hpp"
+
+using std::string;
+
+static const char *serverSocketPath = nullptr;
+
+static void removeSocketAndExit(int) {
+    unlink(serverSocketPath);
+    _exit(0);
+}
+
+static bool makeAddress(const char *socketPath, sockaddr_un &address) {
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    return true;
+}
+
+static void serveConnection(int connection) {
+    SourceFile source;
+    if (not source.load(connection)) {
+        reportError(string("reading request: ") + strerror(errno));
+        return;
+    }
+
+    OutputWriter out(connection);
+    compileSource(source, out, "request", CompileOptions());
+    // A client that went away before reading the answer is its own problem
+    out.flush();
+}
+
+int runServer(const char *socketPath, int jobs) {
+    sockaddr_un address;
+    int listener = -1;
+    struct stat st;
+
+    // A socket left behind by a server that was killed would fail bind, but anything else at the path is left alone
+    if (lstat(socketPath, &st) == 0 and S_ISSOCK(st.st_mode)) {
+        unlink(socketPath);
+    }
+
+    if (not makeAddress(socketPath, address) or (listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0 or
+        bind(listener, (sockaddr *)&address, sizeof(address)) != 0 or listen(listener, SOMAXCONN) != 0) {
+        reportError(string(socketPath) + ": " + strerror(errno));
+        if (listener >= 0) {
+            close(listener);
+        }
+        return 1;
+    }
+
+    serverSocketPath = socketPath;
+    signal(SIGINT, removeSocketAndExit);
+    signal(SIGTERM, removeSocketAndExit);
+    // Writing an answer to a client that already disconnected must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    // Each thread accepts and serves its own connections, one at a time
+    auto worker = [listener]() {
+        for (;;) {
+            int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (connection < 0) {
+                if (errno != EINTR and errno != ECONNABORTED) {
+                    reportError(string("accept: ") + strerror(errno));
+                }
+                continue;
+            }
+
+            serveConnection(connection);
+            close(connection);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < jobs; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    return 0;
+}
+
+int runClient(const char *socketPath, const char *inputPath, const char *outputPath) {
+    SourceFile source;
+    if (not source.open(inputPath)) {
+        reportError(string(inputPath ? inputPath : "stdin") + ": " + strerror(errno));
+        return 1;
+    }
+
+    OutputWriter out;
+    if (outputPath and not out.open(outputPath)) {
+        reportError(string(outputPath) + ": " + strerror(errno));
+        return 1;
+    }
+
+    sockaddr_un address;
+    int connection = -1;
+    if (not makeAddress(socketPath, address) or (connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0 or
+        connect(connection, (sockaddr *)&address, sizeof(address)) != 0) {
+        reportError(string(socketPath) + ": " + strerror(errno));
+        if (connection >= 0) {
+            close(connection);
+        }
+        return 1;
+    }
+
+    // Report a server that closed the connection early as a failed write instead of dying of SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+
+    bool ok;
+    {
+        OutputWriter request(connection);
+        request.write(source.getSource(), source.getSourceSize());
+        ok = request.flush() and shutdown(connection, SHUT_WR) == 0;
+    }
+
+    char chunk[1 << 16];
+    ssize_t readSize;
+    while (ok and (readSize = read(connection, chunk, sizeof(chunk))) != 0) {
+        if (readSize < 0) {
+            ok = errno == EINTR;
+            continue;
+        }
+        out.write(chunk, readSize);
+    }
+
+    if (not ok) {
+        reportError(string(socketPath) + ": " + strerror(errno));
+    }
+    close(connection);
+
+    if (not out.flush()) {
+        reportError(string(outputPath ? outputPath : "stdout") + ": " + strerror(errno));
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
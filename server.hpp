@@ -0,0 +1,14 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+// A compile request is a connection to the server's Unix socket. The client sends the source and shuts down its
+// writing side, and the server answers with exactly what hw5 would print for that source (the IR, or the error) and
+// closes the connection. Every request gets a fresh compilation, so nothing carries over between requests
+
+// Serve compile requests on socketPath with jobs threads, until killed. Returns only if the socket can't be set up
+int runServer(const char *socketPath, int jobs);
+// Send the source at inputPath (stdin if null) to the server on socketPath, and write its answer to outputPath (stdout
+// if null). Returns the exit status for the client
+int runClient(const char *socketPath, const char *inputPath, const char *outputPath);
+
+#endif
@@ -0,0 +1,346 @@
+#include "specialize.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <unordered_set>
+
+#include "bp.hpp"
+#include "irText.hpp"
+#include "stypes.hpp"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+// Functions are only cloned up to this many times, and only if they are at most this many lines. All the clones
+// together are at most MAX_CLONED_LINES lines
+static const size_t MAX_CLONES_PER_FUNCTION = 8;
+static const size_t MAX_FUNCTION_LINES = 1000;
+static const size_t MAX_CLONED_LINES = 20000;
+
+Specializer::Specializer() : functions(), clonedLines(0) {}
+
+void Specializer::addFunction(const FuncIdC &funcId, int definitionAddress) {
+    Function &function = this->functions[funcId.getId()];
+    function.definitionAddress = definitionAddress;
+    function.endAddress = CodeBuffer::instance().getCodeSize();
+}
+
+// ******** Constants ********** //
+
+static bool isConstant(const string &value) {
+    if (value == "true" or value == "false") {
+        return true;
+    }
+    size_t digits = value[0] == '-' ? 1 : 0;
+    return digits < value.size() and value.find_first_not_of("0123456789", digits) == string::npos;
+}
+
+static long long parseConstant(const string &value) {
+    if (value == "true" or value == "false") {
+        return value == "true";
+    }
+    return atoll(value.c_str());
+}
+
+// value as an unsigned and as a signed integer of type
+static uint64_t toUnsigned(long long value, int bits) {
+    return bits == 64 ? (uint64_t)value : (uint64_t)value & ((1ULL << bits) - 1);
+}
+
+static long long toSigned(long long value, int bits) {
+    uint64_t bitsValue = toUnsigned(value, bits);
+    if (bits < 64 and (bitsValue >> (bits - 1))) {
+        return (long long)(bitsValue - (1ULL << bits));
+    }
+    return (long long)bitsValue;
+}
+
+static string formatConstant(long long value, const string &type) {
+    int bits = getBits(type);
+    if (bits == 1) {
+        return toUnsigned(value, 1) ? "true" : "false";
+    }
+    // Bytes are unsigned in FanC
+    return bits == 8 ? to_string(toUnsigned(value, bits)) : to_string(toSigned(value, bits));
+}
+
+// ******** Folding ********** //
+
+// Fold the binary operation, comparison or cast in words (e.g. {"%r", "=", "add", "i32", "1", "2"}) into result.
+// Returns false if it isn't one on constants
+static bool foldInstruction(const vector<string> &words, string &result) {
+    if (words.size() < 6 or words[1] != "=") {
+        return false;
+    }
+    const string &op = words[2];
+
+    if ((op == "zext" or op == "sext" or op == "trunc") and words.size() == 7 and isConstant(words[4])) {
+        int fromBits = getBits(words[3]);
+        if (fromBits == 0 or getBits(words[6]) == 0) {
+            return false;
+        }
+        long long value = parseConstant(words[4]);
+        value = op == "sext" ? toSigned(value, fromBits) : (long long)toUnsigned(value, fromBits);
+        result = formatConstant(value, words[6]);
+        return true;
+    }
+
+    if (op == "icmp" and words.size() == 7 and isConstant(words[5]) and isConstant(words[6])) {
+        const string &predicate = words[3];
+        int bits = getBits(words[4]);
+        if (bits == 0) {
+            return false;
+        }
+        long long a = parseConstant(words[5]);
+        long long b = parseConstant(words[6]);
+        long long sa = toSigned(a, bits), sb = toSigned(b, bits);
+        uint64_t ua = toUnsigned(a, bits), ub = toUnsigned(b, bits);
+        bool value;
+        if (predicate == "eq") {
+            value = ua == ub;
+        } else if (predicate == "ne") {
+            value = ua != ub;
+        } else if (predicate == "sgt") {
+            value = sa > sb;
+        } else if (predicate == "sge") {
+            value = sa >= sb;
+        } else if (predicate == "slt") {
+            value = sa < sb;
+        } else if (predicate == "sle") {
+            value = sa <= sb;
+        } else if (predicate == "ugt") {
+            value = ua > ub;
+        } else if (predicate == "uge") {
+            value = ua >= ub;
+        } else if (predicate == "ult") {
+            value = ua < ub;
+        } else if (predicate == "ule") {
+            value = ua <= ub;
+        } else {
+            return false;
+        }
+        result = value ? "true" : "false";
+        return true;
+    }
+
+    if (words.size() != 6 or not isConstant(words[4]) or not isConstant(words[5])) {
+        return false;
+    }
+    const string &type = words[3];
+    int bits = getBits(type);
+    if (bits == 0) {
+        return false;
+    }
+    long long a = parseConstant(words[4]);
+    long long b = parseConstant(words[5]);
+    long long value;
+    if (op == "add") {
+        value = a + b;
+    } else if (op == "sub") {
+        value = a - b;
+    } else if (op == "mul") {
+        value = (long long)(toUnsigned(a, bits) * toUnsigned(b, bits));
+    } else if (op == "and") {
+        value = a & b;
+    } else if (op == "or") {
+        value = a | b;
+    } else if (op == "xor") {
+        value = a ^ b;
+    } else if (op == "sdiv" and toSigned(b, bits) != 0 and not(toSigned(b, bits) == -1 and toSigned(a, bits) == INT32_MIN)) {
+        value = toSigned(a, bits) / toSigned(b, bits);
+    } else if (op == "udiv" and toUnsigned(b, bits) != 0) {
+        value = (long long)(toUnsigned(a, bits) / toUnsigned(b, bits));
+    } else {
+        return false;
+    }
+    result = formatConstant(value, type);
+    return true;
+}
+
+bool Specializer::emitClone(const Function &function, const string &cloneName, const vector<string> &args) {
+    auto &buffer = CodeBuffer::instance();
+    std::unordered_map<string, string> values;
+    vector<string> clone;
+
+    // The define line, without the specialized parameters
+    const string &definition = buffer.getCodeLine(function.definitionAddress);
+    size_t nameStart = definition.find('@');
+    size_t paramsStart = definition.find('(', nameStart);
+    size_t paramsEnd = definition.find(')', paramsStart);
+    string params;
+    std::istringstream paramStream(definition.substr(paramsStart + 1, paramsEnd - paramsStart - 1));
+    string param;
+    for (size_t i = 0; std::getline(paramStream, param, ','); i++) {
+        size_t start = param.find_first_not_of(' ');
+        param = param.substr(start);
+        if (i < args.size() and not args[i].empty()) {
+            values[param.substr(param.find(' ') + 1)] = args[i].substr(args[i].find(' ') + 1);
+        } else {
+            params += (params.empty() ? "" : ", ") + param;
+        }
+    }
+    clone.push_back(definition.substr(0, nameStart + 1) + cloneName + "(" + params + definition.substr(paramsEnd));
+
+    // One pass in code order, in which blocks are reached before they are branched to, other than loop conditions
+    // branched back to, which were reached before. Blocks that aren't reached by then never are, and are dropped
+    std::unordered_set<string> reachable = {""};
+    std::unordered_set<string> dropped;
+    std::set<std::pair<string, string>> edges;
+    std::unordered_set<string> seen;
+    string block = "";
+    bool inReachable = true;
+    bool afterTerminator = false;
+    auto branchTo = [&](const string &target) {
+        if (dropped.count(target)) {
+            return false;
+        }
+        reachable.insert(target);
+        edges.insert({block, target});
+        return true;
+    };
+
+    for (int address = function.definitionAddress + 1; address < function.endAddress; address++) {
+        const string &line = buffer.getCodeLine(address);
+        size_t suffix = line.rfind(" ; ");
+        size_t indentation = std::min(line.find_first_not_of('\t'), line.size());
+        string body = line.substr(indentation, (suffix == string::npos ? line.size() : suffix) - indentation);
+        string tail = suffix == string::npos ? "" : line.substr(suffix);
+
+        if (body.empty()) {
+            continue;
+        }
+        if (body == "}" or body[0] == ';') {
+            if (inReachable or body == "}") {
+                clone.push_back(line);
+            }
+            continue;
+        }
+        if (body.back() == ':') {
+            block = body.substr(0, body.size() - 1);
+            seen.insert(block);
+            inReachable = reachable.count(block) != 0;
+            afterTerminator = false;
+            if (not inReachable) {
+                dropped.insert(block);
+            } else {
+                clone.push_back(line);
+            }
+            continue;
+        }
+        if (afterTerminator) {
+            // An unnamed block, which nothing can branch to
+            inReachable = false;
+        }
+        if (not inReachable) {
+            continue;
+        }
+
+        body = substitute(body, values);
+        vector<string> words = splitInstruction(body);
+        string result;
+        if (words.size() > 3 and words[2] == "phi") {
+            // Keep the incoming values of the edges that are still there, or not known yet
+            string kept;
+            size_t count = 0;
+            string lastValue;
+            for (size_t open = body.find('['); open != string::npos; open = body.find('[', open + 1)) {
+                size_t close = body.find(']', open);
+                string entry = body.substr(open + 1, close - open - 1);
+                size_t comma = entry.find(',');
+                string value = entry.substr(entry.find_first_not_of(' '), comma - entry.find_first_not_of(' '));
+                string from = entry.substr(entry.find('%', comma) + 1);
+                if (seen.count(from) and not edges.count({from, block})) {
+                    continue;
+                }
+                kept += (count ? ", [" : "[") + entry + "]";
+                lastValue = value;
+                count++;
+            }
+            if (count == 0) {
+                return false;
+            }
+            if (count == 1) {
+                values[words[0]] = lastValue;
+                continue;
+            }
+            body = body.substr(0, body.find('[')) + kept;
+        } else if (foldInstruction(words, result)) {
+            values[words[0]] = result;
+            continue;
+        } else if (words[0] == "br") {
+            if (words.size() >= 7 and words[1] == "i1" and isConstant(words[2])) {
+                string target = (parseConstant(words[2]) ? words[4] : words[6]).substr(1);
+                body = "br label %" + target;
+                if (not branchTo(target)) {
+                    return false;
+                }
+            } else {
+                for (size_t i = 1; i + 1 < words.size(); i++) {
+                    if (words[i] == "label" and not branchTo(words[i + 1].substr(1))) {
+                        return false;
+                    }
+                }
+            }
+        }
+        if (words[0] == "br" or words[0] == "ret" or words[0] == "unreachable") {
+            afterTerminator = true;
+        }
+        clone.push_back(line.substr(0, indentation) + body + tail);
+    }
+
+    clone.push_back("");
+    for (auto &line : clone) {
+        buffer.emitGlobal(line);
+    }
+    this->clonedLines += clone.size();
+    return true;
+}
+
+string Specializer::specializeCall(const FuncIdC &funcId, vector<string> &args) {
+    auto found = this->functions.find(funcId.getId());
+    if (found == this->functions.end()) {
+        return funcId.getName();
+    }
+    Function &function = found->second;
+
+    vector<string> constantArgs(args.size());
+    bool anyConstant = false;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (isConstant(args[i].substr(args[i].find(' ') + 1))) {
+            constantArgs[i] = args[i];
+            anyConstant = true;
+        }
+    }
+    if (not anyConstant) {
+        return funcId.getName();
+    }
+
+    auto clone = function.clones.find(constantArgs);
+    if (clone == function.clones.end()) {
+        size_t size = function.endAddress - function.definitionAddress;
+        if (function.clones.size() >= MAX_CLONES_PER_FUNCTION or size > MAX_FUNCTION_LINES or
+            this->clonedLines + size > MAX_CLONED_LINES) {
+            return funcId.getName();
+        }
+        string cloneName = funcId.getName() + ".specialized_" + to_string(function.clones.size() + 1);
+        if (not this->emitClone(function, cloneName, constantArgs)) {
+            cloneName = "";
+        }
+        clone = function.clones.emplace(constantArgs, cloneName).first;
+    }
+    if (clone->second.empty()) {
+        return funcId.getName();
+    }
+
+    vector<string> remainingArgs;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (constantArgs[i].empty()) {
+            remainingArgs.push_back(args[i]);
+        }
+    }
+    args = remainingArgs;
+    return clone->second;
+}
@@ -0,0 +1,45 @@
+#ifndef SPECIALIZE_H_
+#define SPECIALIZE_H_
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "interner.hpp"
+
+class FuncIdC;
+
+// Interprocedural constant propagation for --specialize. A call passing literal arguments to a function that is already
+// lowered calls a clone of it instead, with those parameters replaced by the literals. The clone's instructions that
+// only depend on constants are folded away, branches they decide become unconditional, and the blocks no longer
+// reached are dropped. A call site agreeing with an earlier one reuses its clone, so when all the call sites of a
+// function agree, the original is left uncalled. Clones are emitted with the globals, and their number and size are
+// capped to bound the growth of the code
+class Specializer {
+    struct Function {
+        // Code buffer range of the function, from its define line to its closing brace
+        int definitionAddress;
+        int endAddress;
+        // Clones by the arguments they were specialized for, "" for the ones they weren't
+        std::map<std::vector<std::string>, std::string> clones;
+    };
+
+    std::unordered_map<SymbolId, Function> functions;
+    size_t clonedLines;
+
+    // Emit a clone of function named cloneName for args, or return false if it couldn't be folded
+    bool emitClone(const Function &function, const std::string &cloneName, const std::vector<std::string> &args);
+
+   public:
+    Specializer();
+    Specializer(const Specializer &) = delete;
+    void operator=(const Specializer &) = delete;
+    // Make the function lowered between definitionAddress and the end of the code buffer available for specializing
+    void addFunction(const FuncIdC &funcId, int definitionAddress);
+    // The name of the function to call instead of funcId with args (each "type value"), or funcId's own name. Removes
+    // the arguments the clone was specialized for from args
+    std::string specializeCall(const FuncIdC &funcId, std::vector<std::string> &args);
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "stats.hpp"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdio>
+
+using std::string;
+
+typedef std::chrono::steady_clock Clock;
+
+thread_local CompileStats *activeStats = nullptr;
+// The phase time is charged to on this thread, and when it was entered or last charged
+static thread_local Phase currentPhase = Phase::OTHER;
+static thread_local Clock::time_point phaseStart;
+
+static const char *const PHASE_NAMES[(int)Phase::COUNT] = {"other", "lex", "cache", "parse", "emit", "backpatch", "print"};
+static const char *const SUBSYSTEM_NAMES[(int)Subsystem::COUNT] = {"tokens", "interner", "symbolTable", "codeBuffer"};
+
+static const struct {
+    const char *name;
+    size_t CompileStats::*counter;
+} COUNTERS[] = {
+    {"tokens", &CompileStats::tokens},
+    {"reductions", &CompileStats::reductions},
+    {"codeLines", &CompileStats::codeLines},
+    {"globalLines", &CompileStats::globalLines},
+    {"labels", &CompileStats::labels},
+    {"registers", &CompileStats::registers},
+    {"stringConstants", &CompileStats::stringConstants},
+    {"reusedStringConstants", &CompileStats::reusedStringConstants},
+    {"backpatches", &CompileStats::backpatches},
+    {"functions", &CompileStats::functions},
+    {"cachedFunctions", &CompileStats::cachedFunctions},
+    {"unrolledLoops", &CompileStats::unrolledLoops},
+    {"partiallyUnrolledLoops", &CompileStats::partiallyUnrolledLoops},
+    {"loopsOverUnrollBudget", &CompileStats::loopsOverUnrollBudget},
+    {"unrolledCopies", &CompileStats::unrolledCopies},
+    {"rotatedLoops", &CompileStats::rotatedLoops},
+    {"deadDefinitions", &CompileStats::deadDefinitions},
+};
+
+static void chargeCurrentPhase() {
+    Clock::time_point now = Clock::now();
+    activeStats->phases[(int)currentPhase].seconds += std::chrono::duration<double>(now - phaseStart).count();
+    phaseStart = now;
+}
+
+StatsCollection::StatsCollection(CompileStats &stats) {
+    stats = CompileStats();
+    activeStats = &stats;
+    currentPhase = Phase::OTHER;
+    phaseStart = Clock::now();
+}
+
+// ru_maxrss outlives exec, so a process started by a large one would report its parent's peak. VmHWM is reset by exec,
+// and getrusage is only the fallback for systems without /proc
+static long getPeakRssKb() {
+    long peakRssKb = -1;
+    if (FILE *status = fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (fgets(line, sizeof(line), status)) {
+            if (sscanf(line, "VmHWM: %ld kB", &peakRssKb) == 1) {
+                break;
+            }
+        }
+        fclose(status);
+    }
+    rusage usage;
+    if (peakRssKb < 0 and getrusage(RUSAGE_SELF, &usage) == 0) {
+        peakRssKb = usage.ru_maxrss;
+    }
+    return peakRssKb;
+}
+
+StatsCollection::~StatsCollection() {
+    chargeCurrentPhase();
+    activeStats->peakRssKb = getPeakRssKb();
+    activeStats = nullptr;
+}
+
+void PhaseScope::enter(Phase phase) {
+    chargeCurrentPhase();
+    this->previous = currentPhase;
+    currentPhase = phase;
+}
+
+void PhaseScope::leave() {
+    chargeCurrentPhase();
+    currentPhase = this->previous;
+}
+
+string quoteJson(const string &text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' or c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+string CompileStats::format(StatsFormat format, const string &sourceName) const {
+    char line[256];
+    string report;
+    double totalSeconds = 0;
+    for (auto &phase : this->phases) {
+        totalSeconds += phase.seconds;
+    }
+    SubsystemStats total = {0, 0};
+    for (auto &subsystem : this->subsystems) {
+        total.allocations += subsystem.allocations;
+        total.allocatedBytes += subsystem.allocatedBytes;
+    }
+
+    if (format == StatsFormat::JSON) {
+        report = "{\"source\": " + quoteJson(sourceName) + ", \"phases\": {";
+        for (int i = 0; i < (int)Phase::COUNT; i++) {
+            snprintf(line, sizeof(line), "%s\"%s\": {\"ms\": %.3f}", i ? ", " : "", PHASE_NAMES[i], this->phases[i].seconds * 1000);
+            report += line;
+        }
+        snprintf(line, sizeof(line), "}, \"totalMs\": %.3f, \"subsystems\": {", totalSeconds * 1000);
+        report += line;
+        for (int i = 0; i < (int)Subsystem::COUNT; i++) {
+            snprintf(line, sizeof(line), "%s\"%s\": {\"allocations\": %zu, \"bytes\": %zu}", i ? ", " : "",
+                     SUBSYSTEM_NAMES[i], this->subsystems[i].allocations, this->subsystems[i].allocatedBytes);
+            report += line;
+        }
+        report += "}";
+        for (auto &counter : COUNTERS) {
+            snprintf(line, sizeof(line), ", \"%s\": %zu", counter.name, this->*counter.counter);
+            report += line;
+        }
+        snprintf(line, sizeof(line), ", \"peakRssKb\": %ld}\n", this->peakRssKb);
+        return report + line;
+    }
+
+    report = "stats for " + sourceName + ":\n";
+    snprintf(line, sizeof(line), "  %-12s %10s\n", "phase", "ms");
+    report += line;
+    for (int i = 0; i <= (int)Phase::COUNT; i++) {
+        snprintf(line, sizeof(line), "  %-12s %10.3f\n", i < (int)Phase::COUNT ? PHASE_NAMES[i] : "total",
+                 (i < (int)Phase::COUNT ? this->phases[i].seconds : totalSeconds) * 1000);
+        report += line;
+    }
+    snprintf(line, sizeof(line), "  %-12s %12s %14s\n", "subsystem", "allocations", "bytes");
+    report += line;
+    for (int i = 0; i <= (int)Subsystem::COUNT; i++) {
+        const SubsystemStats &subsystem = i < (int)Subsystem::COUNT ? this->subsystems[i] : total;
+        snprintf(line, sizeof(line), "  %-12s %12zu %14zu\n", i < (int)Subsystem::COUNT ? SUBSYSTEM_NAMES[i] : "total",
+                 subsystem.allocations, subsystem.allocatedBytes);
+        report += line;
+    }
+    for (auto &counter : COUNTERS) {
+        snprintf(line, sizeof(line), "  %-22s %10zu\n", counter.name, this->*counter.counter);
+        report += line;
+    }
+    snprintf(line, sizeof(line), "  %-22s %10ld\n", "peakRssKb", this->peakRssKb);
+    return report + line;
+}
@@ -0,0 +1,124 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <cstddef>
+#include <string>
+
+// The phases of a compilation that time is charged to. Phases nest (emission happens while parsing), and whatever
+// happens in a nested phase is charged only to it
+enum class Phase { OTHER, LEX, CACHE, PARSE, EMIT, BACKPATCH, PRINT, COUNT };
+
+// The parts of the compiler whose memory grows with the source, which count their allocations
+enum class Subsystem { TOKENS, INTERNER, SYMBOL_TABLE, CODE_BUFFER, COUNT };
+
+enum class StatsFormat { NONE, TEXT, JSON };
+
+struct CompileStats {
+    struct PhaseStats {
+        double seconds;
+    };
+    struct SubsystemStats {
+        size_t allocations;
+        size_t allocatedBytes;
+    };
+
+    PhaseStats phases[(int)Phase::COUNT];
+    SubsystemStats subsystems[(int)Subsystem::COUNT];
+    size_t tokens;
+    size_t reductions;
+    size_t codeLines;
+    size_t globalLines;
+    size_t labels;
+    size_t registers;
+    // String constants defined, and uses of a string constant the function being lowered already defined
+    size_t stringConstants;
+    size_t reusedStringConstants;
+    size_t backpatches;
+    size_t functions;
+    size_t cachedFunctions;
+    // Loops --unroll replaced by copies of their body, unrolled by its factor, or left alone for the size budget, and
+    // the copies made
+    size_t unrolledLoops;
+    size_t partiallyUnrolledLoops;
+    size_t loopsOverUnrollBudget;
+    size_t unrolledCopies;
+    // Loops rotated to test their condition at the bottom
+    size_t rotatedLoops;
+    // Functions, declarations and globals left out as main can't reach them
+    size_t deadDefinitions;
+    // Of the whole process, so in batch mode it covers all the sources compiled so far
+    long peakRssKb;
+
+    // The report, as text or as a single line of JSON
+    std::string format(StatsFormat format, const std::string &sourceName) const;
+};
+
+// The stats the calling thread's compilation is collecting, or null
+extern thread_local CompileStats *activeStats;
+
+// Collects stats of the calling thread's compilation into stats for its lifetime
+class StatsCollection {
+   public:
+    explicit StatsCollection(CompileStats &stats);
+    StatsCollection(const StatsCollection &) = delete;
+    void operator=(const StatsCollection &) = delete;
+    ~StatsCollection();
+};
+
+// Charges time to phase for its lifetime. Does nothing unless stats are being collected
+class PhaseScope {
+    Phase previous;
+    bool active;
+
+    void enter(Phase phase);
+    void leave();
+
+   public:
+    explicit PhaseScope(Phase phase) : previous(Phase::OTHER), active(activeStats != nullptr) {
+        if (this->active) {
+            this->enter(phase);
+        }
+    }
+    PhaseScope(const PhaseScope &) = delete;
+    void operator=(const PhaseScope &) = delete;
+    ~PhaseScope() {
+        if (this->active) {
+            this->leave();
+        }
+    }
+};
+
+// text as a JSON string literal
+std::string quoteJson(const std::string &text);
+
+// Count one of a counter of the calling thread's compilation, e.g. countStat(&CompileStats::labels)
+inline void countStat(size_t CompileStats::*counter) {
+    if (activeStats) {
+        activeStats->*counter += 1;
+    }
+}
+
+// Count an allocation of bytes by subsystem
+inline void countAllocation(Subsystem subsystem, size_t bytes) {
+    if (activeStats) {
+        activeStats->subsystems[(int)subsystem].allocations++;
+        activeStats->subsystems[(int)subsystem].allocatedBytes += bytes;
+    }
+}
+
+// Count the new storage of container, if it grew past capacityBefore
+template <class Container>
+inline void countGrowth(Subsystem subsystem, const Container &container, size_t capacityBefore) {
+    if (container.capacity() != capacityBefore) {
+        countAllocation(subsystem, container.capacity() * sizeof(typename Container::value_type));
+    }
+}
+
+// Count the storage of text, unless it is short enough to be kept in the string itself
+inline void countString(Subsystem subsystem, const std::string &text) {
+    if (text.capacity() > std::string().capacity()) {
+        countAllocation(subsystem, text.capacity() + 1);
+    }
+}
+
+#endif
@@ -1,66 +1,67 @@
 #include "stypes.hpp"
 
 #include "bp.hpp"
+#include "compilation.hpp"
+#include "debugInfo.hpp"
+#include "evaluate.hpp"
+#include "memo.hpp"
+#include "specialize.hpp"
+#include "funcCache.hpp"
 #include "hw3_output.hpp"
 #include "parser.tab.hpp"
+#include "profile.hpp"
 #include "ralloc.hpp"
-#include "symbolTable.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 using namespace output;
 
-extern SymbolTable symbolTable;
+typedef yy::parser::token token;
 
-template <typename Base, typename T>
-inline bool instanceof (const T *ptr) {
-    return dynamic_cast<const Base *>(ptr) != nullptr;
-}
-
-STypeC::STypeC(SymbolType symType) : symType(symType) {}
 
-RetTypeNameC::RetTypeNameC(const string &type) : STypeC(STRetType), type(verifyRetTypeName(type)) {}
+RetTypeNameC::RetTypeNameC(TypeName type) : type(verifyRetTypeName(type)) {}
 
-VarTypeNameC::VarTypeNameC(const string &type) : RetTypeNameC(verifyVarTypeName(type)) {}
+VarTypeNameC::VarTypeNameC(TypeName type) : RetTypeNameC(verifyVarTypeName(type)) {}
 
-ExpC::ExpC(const string &type, const string &regOrImmStr) : STypeC(STExpression), type(verifyValTypeName(type)), registerOrImmediate(regOrImmStr) {
-    if (regOrImmStr[0] != '%' and type == "BYTE" and stoi(regOrImmStr) > 255) {
+ExpC::ExpC(TypeName type, const string &regOrImmStr) : type(verifyValTypeName(type)), registerOrImmediate(regOrImmStr) {
+    if (regOrImmStr[0] != '%' and type == TypeName::BYTE and stoi(regOrImmStr) > 255) {
         errorByteTooLarge(yylineno, regOrImmStr);
     }
 
-    if (type != "SC_BOOL" and regOrImmStr == "") {
-        throw Exception("Only SC_BOOL can have no register");
+    if (regOrImmStr == "") {
+        throw Exception("ExpC must have a register or immediate");
     }
+}
 
-    // auto &buffer = CodeBuffer::instance();
-    // this->expStartLabel = buffer.genLabel(type + "Start");
+bool ExpC::isEmpty() const {
+    return this->type == TypeName::VOID;
 }
 
 bool ExpC::isInt() const {
-    return this->type == "INT";
+    return this->type == TypeName::INT;
 }
 
 bool ExpC::isBool() const {
-    return this->type == "BOOL";
+    return this->type == TypeName::BOOL;
 }
 
 bool ExpC::isString() const {
-    return this->type == "STRING";
+    return this->type == TypeName::STRING;
 }
 
 bool ExpC::isByte() const {
-    return this->type == "BYTE";
+    return this->type == TypeName::BYTE;
 }
 
 ShortCircuitBool::ShortCircuitBool(const AddressList &trueList, const AddressList &falseList)
-    : ExpC("SC_BOOL", ""), boolTrueList(trueList), boolFalseList(falseList) {}
+    : boolFalseList(falseList), boolTrueList(trueList) {}
 
-ShortCircuitBool::ShortCircuitBool(shared_ptr<ExpC> boolExp) : ShortCircuitBool(AddressList(), AddressList()) {
-    if (boolExp == nullptr) {
-        throw Exception("Can't convert nullptr ExpC to ShortCircuitBool");
-    } else if (not boolExp->isBool()) {
+ShortCircuitBool::ShortCircuitBool(const ExpC &boolExp) {
+    if (not boolExp.isBool()) {
         throw Exception("Can't convert non BOOL ExpC to ShortCircuitBool");
     }
     auto &buffer = CodeBuffer::instance();
-    int instrAddr = buffer.emit("br i1 " + boolExp->getRegOrImmResult() + ", label @, label @");
+    int instrAddr = buffer.emit("br i1 " + boolExp.getRegOrImmResult() + ", label @, label @");
     this->boolTrueList.push_back(make_pair(instrAddr, FIRST));
     this->boolFalseList.push_back(make_pair(instrAddr, SECOND));
 }
@@ -78,50 +79,41 @@ AddressList &ShortCircuitBool::getTrueList() {
 /* Assures that the expression has a register with the result.
  *   To assure even short-circuit bool expressions (that don't have reg) are being assigned with result reg properly.
  */
-string ExpC::getRegOrImmResult() {
-    if (instanceof <ShortCircuitBool>(this)) {
-        throw Exception("Trying to get RegOrImm for ShortCircuitBool");
-    }
+const string &ExpC::getRegOrImmResult() const {
     if (this->registerOrImmediate == "") {
         throw Exception("ExpC without register or immediate");
     }
     return this->registerOrImmediate;
 }
 
-shared_ptr<ExpC> ExpC::getBinOpResult(shared_ptr<STypeC> stype1, shared_ptr<STypeC> stype2, int op) {
-    shared_ptr<ExpC> exp1 = DC(ExpC, stype1);
-    shared_ptr<ExpC> exp2 = DC(ExpC, stype2);
-    shared_ptr<ExpC> resultExp;
+ExpC ExpC::getBinOpResult(const ExpC &exp1, const ExpC &exp2, int op) {
     Ralloc &ralloc = Ralloc::instance();
     CodeBuffer &codeBuffer = CodeBuffer::instance();
-    string resultSizeof;
-    string resultType;
+    TypeName resultType;
     string divOp;
     string opStr;
     string resultReg = ralloc.getNextReg("getBinOpResult");
-    string exp1Reg = exp1->getRegOrImmResult();
-    string exp2Reg = exp2->getRegOrImmResult();
+    string exp1Reg = exp1.getRegOrImmResult();
+    string exp2Reg = exp2.getRegOrImmResult();
 
-    if (not isImpliedCastAllowed(stype1, stype2)) {
+    if (not isImpliedCastAllowed(exp1, exp2)) {
         errorMismatch(yylineno);
     }
-    if (exp1->isInt() or exp2->isInt()) {
-        if (exp1->isByte()) {
+    if (exp1.isInt() or exp2.isInt()) {
+        if (exp1.isByte()) {
             string resultReg = ralloc.getNextReg("binOpResExp1");
             codeBuffer.emit(resultReg + " = zext i8 " + exp1Reg + " to i32");
             exp1Reg = resultReg;
-        } else if (exp2->isByte()) {
+        } else if (exp2.isByte()) {
             string resultReg = ralloc.getNextReg("binOpResExp1");
             codeBuffer.emit(resultReg + " = zext i8 " + exp2Reg + " to i32");
             exp2Reg = resultReg;
         }
-        resultSizeof = "i32";
-        resultType = "INT";
+        resultType = TypeName::INT;
         // BYTE is upcasted to INT
         divOp = "sdiv";
     } else {
-        resultSizeof = "i8";
-        resultType = "BYTE";
+        resultType = TypeName::BYTE;
         divOp = "udiv";
     }
 
@@ -132,22 +124,30 @@ shared_ptr<ExpC> ExpC::getBinOpResult(shared_ptr<STypeC> stype1, shared_ptr<STyp
 
     // Emit the llvm ir code
     switch (op) {
-        case ADDOP:
+        case token::ADDOP:
             opStr = "add";
             break;
-        case SUBOP:
+        case token::SUBOP:
             opStr = "sub";
             break;
-        case MULOP:
+        case token::MULOP:
             opStr = "mul";
             break;
-        case DIVOP:
+        case token::DIVOP:
             ifShouldErrorDivBy0 = ralloc.getNextReg("divBy0icmp");
 
-            codeBuffer.emit(ifShouldErrorDivBy0 + " = icmp eq " + typeNameToLlvmType(exp2->getType()) + " " + exp2->getRegOrImmResult() + ", 0");
-            instAddr = codeBuffer.emit("br i1 " + ifShouldErrorDivBy0 + ", label @, label @");
+            codeBuffer.emit(ifShouldErrorDivBy0 + " = icmp eq " + typeNameToLlvmType(exp2.getType()) + " " + exp2.getRegOrImmResult() + ", 0");
+            instAddr = codeBuffer.emit("br i1 " + ifShouldErrorDivBy0 + ", label @, label @, !prof " + ERROR_PATH_WEIGHTS);
+            // The error path goes at the end of the function, so the division falls through to its result
+            codeBuffer.startColdCode();
             labelDivBy0 = codeBuffer.genLabel("labelDivBy0");
+            if (Profile *profile = Compilation::current().profile) {
+                profile->beforeExit();
+            }
             codeBuffer.emit("call void @error_division_by_zero()");
+            SymbolTable::instance().currentFunctionEffects |= EXITS;
+            codeBuffer.emit("unreachable");
+            codeBuffer.endColdCode();
             labelNotDivBy0 = codeBuffer.genLabel("labelNotDivBy0");
 
             codeBuffer.bpatch(make_pair(instAddr, FIRST), labelDivBy0);
@@ -158,8 +158,8 @@ shared_ptr<ExpC> ExpC::getBinOpResult(shared_ptr<STypeC> stype1, shared_ptr<STyp
             errorMismatch(yylineno);
     }
 
-    codeBuffer.emit(resultReg + " = " + opStr + " " + resultSizeof + " " + exp1Reg + ", " + exp2Reg);
-    return shared_ptr<ExpC>(NEW(ExpC, (resultType, resultReg)));
+    codeBuffer.emit(resultReg + " = " + opStr + " " + typeNameToLlvmType(resultType) + " " + exp1Reg + ", " + exp2Reg);
+    return ExpC(resultType, resultReg);
 }
 
 static void insertToListFromList(AddressList &listTo, AddressList &listFrom) {
@@ -171,57 +171,33 @@ static void insertToListFromList(AddressList &listTo, AddressList &listFrom) {
 //     bListTo.insert(bListTo.end(), bListFrom.begin(), bListFrom.end());
 // }
 
-shared_ptr<ShortCircuitBool> ShortCircuitBool::evalBool(shared_ptr<STypeC> otherScExpStype, shared_ptr<STypeC> rightOperandStartStype, int op) {
+void ShortCircuitBool::evalBool(ShortCircuitBool *otherScExp, const string &rightOperandStartLabel, int op) {
     auto &buffer = CodeBuffer::instance();
-    shared_ptr<ShortCircuitBool> otherScExp;
-    string secondOperandStartLabel;
-
-    AddressList trueList;
-    AddressList falseList;
-    if (op == OR) {
-        {  // AND/OR Common lines
-            otherScExp = assureScBool(otherScExpStype);
-            secondOperandStartLabel = STYPE2STD(string, rightOperandStartStype);
-        }
-        buffer.bpatch(this->boolFalseList, secondOperandStartLabel);
-        this->boolFalseList = otherScExp->boolFalseList;
+
+    if (op == token::OR) {
+        buffer.bpatch(this->boolFalseList, rightOperandStartLabel);
+        this->boolFalseList = std::move(otherScExp->boolFalseList);
         insertToListFromList(this->boolTrueList, otherScExp->boolTrueList);
-        return shared_from_this();
-    } else if (op == AND) {
-        {  // AND/OR Common lines
-            otherScExp = assureScBool(otherScExpStype);
-            secondOperandStartLabel = STYPE2STD(string, rightOperandStartStype);
-        }
-        buffer.bpatch(this->boolTrueList, secondOperandStartLabel);
+    } else if (op == token::AND) {
+        buffer.bpatch(this->boolTrueList, rightOperandStartLabel);
         insertToListFromList(this->boolFalseList, otherScExp->boolFalseList);
-        this->boolTrueList = otherScExp->boolTrueList;
-        return shared_from_this();
-    } else if (op == NOT) {
-        falseList = this->boolTrueList;
-        trueList = this->boolFalseList;
-        this->boolTrueList = trueList;
-        this->boolFalseList = falseList;
-        return shared_from_this();
+        this->boolTrueList = std::move(otherScExp->boolTrueList);
+    } else if (op == token::NOT) {
+        std::swap(this->boolTrueList, this->boolFalseList);
     } else {
         errorMismatch(yylineno);
         throw Exception("Impossible to reach here");
     }
 }
 
-shared_ptr<ExpC> ExpC::getCmpResult(shared_ptr<STypeC> stype1, shared_ptr<STypeC> stype2, int op) {
-    shared_ptr<ExpC> exp1 = DC(ExpC, stype1);
-    shared_ptr<ExpC> exp2 = DC(ExpC, stype2);
-    if (not exp1 or not exp2) {
-        throw Exception("getCmpResult must get _Nonnull expressions");
-    }
-
+ExpC ExpC::getCmpResult(const ExpC &exp1, const ExpC &exp2, int op) {
     string cmpOpStr;
     string regSizeofDecorator;
 
-    if (not isImpliedCastAllowed(stype1, stype2)) {
+    if (not isImpliedCastAllowed(exp1, exp2)) {
         errorMismatch(yylineno);
         // Warning supression: the prev line will exit
-        return nullptr;
+        return ExpC();
     }
 
     Ralloc &ralloc = Ralloc::instance();
@@ -229,18 +205,18 @@ shared_ptr<ExpC> ExpC::getCmpResult(shared_ptr<STypeC> stype1, shared_ptr<STypeC
 
     string resultReg = ralloc.getNextReg("cmpOpRes");
 
-    string exp1RegOrImm = exp1->getRegOrImmResult();
-    string exp2RegOrImm = exp2->getRegOrImmResult();
+    string exp1RegOrImm = exp1.getRegOrImmResult();
+    string exp2RegOrImm = exp2.getRegOrImmResult();
 
-    shared_ptr<ExpC> resultExp = NEW(ExpC, ("BOOL", resultReg));
+    ExpC resultExp(TypeName::BOOL, resultReg);
 
-    if (exp1->isInt() or exp2->isInt()) {
+    if (exp1.isInt() or exp2.isInt()) {
         regSizeofDecorator = " i32 ";
-        if (exp1->isByte() and exp1RegOrImm[0] == '%') {
+        if (exp1.isByte() and exp1RegOrImm[0] == '%') {
             string newReg = ralloc.getNextReg("cmpOpRegOrImmExp1");
             buffer.emit(newReg + " = zext i8 " + exp1RegOrImm + " to i32");
             exp1RegOrImm = newReg;
-        } else if (exp2->isByte() and exp2RegOrImm[0] == '%') {
+        } else if (exp2.isByte() and exp2RegOrImm[0] == '%') {
             string newReg = ralloc.getNextReg("cmpOpRegOrImmExp2");
             buffer.emit(newReg + " = zext i8 " + exp2RegOrImm + " to i32");
             exp2RegOrImm = newReg;
@@ -250,22 +226,22 @@ shared_ptr<ExpC> ExpC::getCmpResult(shared_ptr<STypeC> stype1, shared_ptr<STypeC
     }
 
     switch (op) {
-        case EQOP:
+        case token::EQOP:
             cmpOpStr = " eq ";
             break;
-        case NEOP:
+        case token::NEOP:
             cmpOpStr = " ne ";
             break;
-        case GEOP:
+        case token::GEOP:
             cmpOpStr = " sge ";
             break;
-        case GTOP:
+        case token::GTOP:
             cmpOpStr = " sgt ";
             break;
-        case LEOP:
+        case token::LEOP:
             cmpOpStr = " sle ";
             break;
-        case LTOP:
+        case token::LTOP:
             cmpOpStr = " slt ";
             break;
         default:
@@ -276,116 +252,120 @@ shared_ptr<ExpC> ExpC::getCmpResult(shared_ptr<STypeC> stype1, shared_ptr<STypeC
     return resultExp;
 }
 
-shared_ptr<ExpC> ExpC::getCastResult(shared_ptr<STypeC> dstStype, shared_ptr<STypeC> expStype) {
-    shared_ptr<ExpC> exp = DC(ExpC, expStype);
-
-    if (not exp) {
-        throw Exception("getCastResult must get _Nonnull ExpC");
-    }
-
-    shared_ptr<VarTypeNameC> dstType = DC(VarTypeNameC, dstStype);
-
-    if (not dstType) {
-        throw Exception("getCastResult must get a _Nonnull VarTypeNameC");
-    }
-
-    if (not areStrTypesCompatible(exp->getType(), dstType->getTypeName()) and not areStrTypesCompatible(dstType->getTypeName(), exp->getType())) {
+ExpC ExpC::getCastResult(const VarTypeNameC &dstType, const ExpC &exp) {
+    if (not areTypesCompatible(exp.getType(), dstType.getTypeName()) and not areTypesCompatible(dstType.getTypeName(), exp.getType())) {
         errorMismatch(yylineno);
         // Warning supression: the prev line will exit
-        return nullptr;
+        return ExpC();
     }
 
-    // Make sure there's a result register or immediate that holds the result of the expression
-    exp->getRegOrImmResult();
-
     Ralloc &ralloc = Ralloc::instance();
     CodeBuffer &codeBuffer = CodeBuffer::instance();
     string resultReg = ralloc.getNextReg("castRes");
 
-    shared_ptr<ExpC> resultExp = NEW(ExpC, (dstType->getTypeName(), resultReg));
+    ExpC resultExp(dstType.getTypeName(), resultReg);
 
-    if (exp->isInt() and dstType->getTypeName() == "BYTE") {
-        codeBuffer.emit(resultReg + " = trunc i32 " + exp->getRegOrImmResult() + " to i8");
-    } else if (exp->isByte() and dstType->getTypeName() == "INT") {
-        codeBuffer.emit(resultReg + " = zext i8 " + exp->getRegOrImmResult() + " to i32");
+    if (exp.isInt() and dstType.getTypeName() == TypeName::BYTE) {
+        codeBuffer.emit(resultReg + " = trunc i32 " + exp.getRegOrImmResult() + " to i8");
+    } else if (exp.isByte() and dstType.getTypeName() == TypeName::INT) {
+        codeBuffer.emit(resultReg + " = zext i8 " + exp.getRegOrImmResult() + " to i32");
     } else {
-        codeBuffer.emit(resultReg + " = add " + typeNameToLlvmType(exp->getType()) + " " + exp->getRegOrImmResult() + ", 0");
+        codeBuffer.emit(resultReg + " = add " + typeNameToLlvmType(exp.getType()) + " " + exp.getRegOrImmResult() + ", 0");
     }
-    codeBuffer.emit("; DEBUG: got cast result (" + dstType->getTypeName() + ") from " + exp->getType());
+    codeBuffer.emit("; DEBUG: got cast result (" + typeNameToString(dstType.getTypeName()) + ") from " + typeNameToString(exp.getType()));
     return resultExp;
 }
 
-shared_ptr<ExpC> ExpC::getCallResult(shared_ptr<FuncIdC> funcId, shared_ptr<STypeC> argsStype) {
-    vector<shared_ptr<ExpC>> args = STYPE2STD(vector<shared_ptr<ExpC>>, argsStype);
+ExpC ExpC::getCallResult(shared_ptr<FuncIdC> funcId, const vector<ExpC> &args) {
     auto &ralloc = Ralloc::instance();
     auto &buffer = CodeBuffer::instance();
     string llvmRetType = typeNameToLlvmType(funcId->getType());
     string resultReg = ralloc.getNextReg("callRes_" + funcId->getName());
-    string resultAssignment = llvmRetType == "void" ? "" : (resultReg + " = ");
+    string resultAssignment = funcId->getType() == TypeName::VOID ? "" : (resultReg + " = ");
     string expListStr = "";
     auto &formalsTypes = funcId->getArgTypes();
 
     if (formalsTypes.size() != args.size()) {
-        errorPrototypeMismatch(yylineno, funcId->getName(), formalsTypes);
+        vector<string> formalsTypeNames = typeNamesToStrings(formalsTypes);
+        errorPrototypeMismatch(yylineno, funcId->getName(), formalsTypeNames);
     }
 
     string argReg;
+    vector<string> callArgs;
 
     for (int i = 0; i < args.size(); i++) {
         // Check type compatibility
-        if (not areStrTypesCompatible(formalsTypes[i], args[i]->getType())) {
+        if (not areTypesCompatible(formalsTypes[i], args[i].getType())) {
             errorMismatch(yylineno);
             // Warning supression: the prev line will exit
-            return nullptr;
+            return ExpC();
         }
 
-        argReg = args[i]->getRegOrImmResult();
-        if (args[i]->getType() != formalsTypes[i]) {
+        argReg = args[i].getRegOrImmResult();
+        if (args[i].getType() != formalsTypes[i]) {
             // zext to passing the argument
             string zextExpReg = ralloc.getNextReg("zextCallFuncArg" + to_string(i) + "_");
-            buffer.emit(zextExpReg + " = zext " + typeNameToLlvmType(args[i]->getType()) + " " + argReg + " to " + typeNameToLlvmType(formalsTypes[i]));
+            buffer.emit(zextExpReg + " = zext " + typeNameToLlvmType(args[i].getType()) + " " + argReg + " to " + typeNameToLlvmType(formalsTypes[i]));
             argReg = zextExpReg;
         }
 
-        expListStr += typeNameToLlvmType(formalsTypes[i]) + " " + argReg + ", ";
+        callArgs.push_back(typeNameToLlvmType(formalsTypes[i]) + " " + argReg);
+    }
+
+    // A call that doesn't print, given literals, is replaced by its result
+    Evaluator *evaluator = Compilation::current().evaluator;
+    string evaluatedResult;
+    if (evaluator and not(funcId->getEffects() & (PRINTS | WRITES_GLOBALS)) and
+        evaluator->evaluateCall(funcId->getName(), callArgs, evaluatedResult)) {
+        return funcId->getType() == TypeName::VOID ? ExpC() : ExpC(funcId->getType(), evaluatedResult);
     }
 
-    if (expListStr.size() > 0) {
-        expListStr.pop_back();
-        expListStr.pop_back();
+    string calleeName = funcId->getName();
+    if (Specializer *specializer = Compilation::current().specializer) {
+        calleeName = specializer->specializeCall(*funcId, callArgs);
+    }
+    for (auto &arg : callArgs) {
+        expListStr += (expListStr.empty() ? "" : ", ") + arg;
     }
 
-    shared_ptr<ExpC> resultExp = nullptr;
+    ExpC resultExp;
 
     // This is valid as long as it doesn't derive from the Exp rule
-    if (funcId->getType() != "VOID") {
-        resultExp = NEW(ExpC, (funcId->getType(), resultReg));
+    if (funcId->getType() != TypeName::VOID) {
+        resultExp = ExpC(funcId->getType(), resultReg);
     }
 
-    buffer.emit(resultAssignment + "call " + llvmRetType + " @" + funcId->getName() + "(" + expListStr + ")");
+    string convention = funcId->isInternal() ? "fastcc " : "";
+    buffer.emit(resultAssignment + "call " + convention + llvmRetType + " @" + calleeName + "(" + expListStr + ")");
+    auto &symbolTable = SymbolTable::instance();
+    if (funcId->getId() == symbolTable.currentFunction) {
+        symbolTable.currentFunctionRecurses = true;
+        symbolTable.currentFunctionEffects |= MAY_RUN_FOREVER;
+    }
+    symbolTable.currentFunctionEffects |= funcId->getEffects();
 
     return resultExp;
 }
 
-shared_ptr<ExpC> ExpC::loadIdValue(shared_ptr<IdC> idSymbol, string stackVariablesPtrReg) {
+ExpC ExpC::loadIdValue(shared_ptr<IdC> idSymbol, const string &stackVariablesPtrReg) {
     CodeBuffer &codeBuffer = CodeBuffer::instance();
     Ralloc &ralloc = Ralloc::instance();
 
     if (idSymbol->getRegisterName() != "") {
-        return NEW(ExpC, (idSymbol->getType(), idSymbol->getRegisterName()));
+        return ExpC(idSymbol->getType(), idSymbol->getRegisterName());
     }
 
     string llvmType = typeNameToLlvmType(idSymbol->getType());
     string offsetReg = ralloc.getNextReg("loadIdOffset");
     string idAddrReg = ralloc.getNextReg("loadIdIdAddr");
     string expReg = ralloc.getNextReg("idVal_" + idSymbol->getName());
-    shared_ptr<ExpC> idValueExpC = NEW(ExpC, (idSymbol->getType(), expReg));
+    ExpC idValueExpC(idSymbol->getType(), expReg);
 
     codeBuffer.emit(offsetReg + " = add i32 0, " + std::to_string(idSymbol->getOffset()));
     codeBuffer.emit(idAddrReg + " = getelementptr i32, i32* " + stackVariablesPtrReg + ", i32 " + offsetReg);
     string idAddrRegCorrectSize = idAddrReg;
 
-    if (llvmType != "i32") {
+    if (idSymbol->getType() != TypeName::INT) {
         idAddrRegCorrectSize = ralloc.getNextReg("idAddrCorrect");
         codeBuffer.emit(idAddrRegCorrectSize + " = bitcast i32* " + idAddrReg + " to " + llvmType + "*");
     }
@@ -395,25 +375,13 @@ shared_ptr<ExpC> ExpC::loadIdValue(shared_ptr<IdC> idSymbol, string stackVariabl
     return idValueExpC;
 }
 
-shared_ptr<ExpC> ExpC::loadStringLiteralAddr(string literal) {
-    literal = literal.substr(1, literal.length() - 2);
-    auto &ralloc = Ralloc::instance();
-    auto &codeBuffer = CodeBuffer::instance();
-    string strLiteralAutoGeneratedName = ralloc.getNextVarName();
-    string resultReg = ralloc.getNextReg("loadStringLiteralResult");
-    int literalLength = literal.length() + 1;  // + 1 for '\0'
-    string literalLenStr = std::to_string(literalLength);
-
-    codeBuffer.emitGlobal(strLiteralAutoGeneratedName + " = constant [" +
-                          literalLenStr + " x i8] c\"" + literal + "\\00\"");
-
-    codeBuffer.emit(resultReg + " = getelementptr [" + literalLenStr + " x i8], [" + literalLenStr + " x i8]* " +
-                    strLiteralAutoGeneratedName + ", i32 0, i32 0");
-
-    return NEW(ExpC, ("STRING", resultReg));
+ExpC ExpC::loadStringLiteralAddr(std::string_view quotedLiteral) {
+    std::string_view literal = quotedLiteral.substr(1, quotedLiteral.length() - 2);
+    return ExpC(TypeName::STRING, CodeBuffer::instance().getStringConstant(string(literal)));
 }
 
-shared_ptr<ExpC> ShortCircuitBool::finallizeToExpC() {
+ExpC ShortCircuitBool::finallizeToExpC() {
+    TraceSpan span("finalize short circuit");
     if (this->boolTrueList.size() == 0 or this->boolFalseList.size() == 0) {
         throw Exception("Can't finallizeToExpC ShortCircuitBool expression when true/false list is empty");
     }
@@ -423,7 +391,7 @@ shared_ptr<ExpC> ShortCircuitBool::finallizeToExpC() {
 
     // Create a new register for the result
     string resultReg = ralloc.getNextReg("finallizedScBool");
-    shared_ptr<ExpC> resultExp = NEW(ExpC, ("BOOL", resultReg));
+    ExpC resultExp(TypeName::BOOL, resultReg);
     AddressList resLabelsList;
 
     // Backpatch true and false lists
@@ -435,24 +403,32 @@ shared_ptr<ExpC> ShortCircuitBool::finallizeToExpC() {
     buffer.bpatch(this->boolTrueList, trueLabel);
     buffer.bpatch(this->boolFalseList, falseLabel);
     // Use phi to merge true and false registers
-    string phiLabel = buffer.genLabel("finallizeScBoolPhi");
+    string phiLabel = buffer.genPhiLabel("finallizeScBoolPhi");
     buffer.emit(resultReg + " = phi i1 [true, %" + trueLabel + "], [false, %" + falseLabel + "]");
     buffer.bpatch(resLabelsList, phiLabel);
     return resultExp;
 }
 
-const string &ExpC::getType() const { return type; }
+TypeName ExpC::getType() const { return type; }
+
+IdC::IdC(SymbolId varId, TypeName type) : id(varId), type(verifyVarTypeName(type)) {}
 
-IdC::IdC(const string &varName, const string &type) : STypeC(STId), name(varName), type(verifyVarTypeName(type)) {}
+SymbolId IdC::getId() const {
+    return this->id;
+}
 
 const string &IdC::getName() const {
-    return this->name;
+    return Interner::instance().getName(this->id);
 }
 
-const string &IdC::getType() const {
+TypeName IdC::getType() const {
     return this->type;
 }
 
+bool IdC::isFunc() const {
+    return false;
+}
+
 void IdC::setOffset(Offset newOffset) {
     this->offset = newOffset;
 }
@@ -469,12 +445,9 @@ void IdC::setRegisterName(string registerName) {
     this->registerName = registerName;
 }
 
-CallC::CallC(const string &type, const string &symbol)
-    : STypeC(STCall), type(verifyRetTypeName(type)), symbol(symbol) {}
-
-// Convert vector<shared_ptr<IdC>> to vector<string> of just the types
-static vector<string> getTypesFromIds(const vector<shared_ptr<IdC>> &ids) {
-    vector<string> types;
+// Convert vector<shared_ptr<IdC>> to vector<TypeName> of just the types
+static vector<TypeName> getTypesFromIds(const vector<shared_ptr<IdC>> &ids) {
+    vector<TypeName> types;
 
     for (auto id : ids) {
         types.push_back(id->getType());
@@ -483,11 +456,14 @@ static vector<string> getTypesFromIds(const vector<shared_ptr<IdC>> &ids) {
     return types;
 }
 
-FuncIdC::FuncIdC(const string &name, const string &type, const vector<shared_ptr<IdC>> &formals, bool isPredefined)
-    : IdC(name, "BAD_VIRTUAL_CALL"),
+FuncIdC::FuncIdC(SymbolId funcId, TypeName type, const vector<shared_ptr<IdC>> &formals, bool isPredefined)
+    : IdC(funcId, TypeName::BAD_VIRTUAL_CALL),
       argTypes(getTypesFromIds(formals)),
       mapFormalNameToReg(),
-      retType(verifyRetTypeName(type)) {
+      retType(verifyRetTypeName(type)),
+      internal(not isPredefined and this->getName() != "main"),
+      effects(NO_EFFECTS),
+      definitionAddress(-1) {
     CodeBuffer &buffer = CodeBuffer::instance();
     Ralloc &ralloc = Ralloc::instance();
     string retTypeStr = typeNameToLlvmType(this->retType);
@@ -510,232 +486,227 @@ FuncIdC::FuncIdC(const string &name, const string &type, const vector<shared_ptr
 
     if (isPredefined) return;
 
-    buffer.emit("define " + retTypeStr + " @" + name + "(" + formalsStr.substr() + ") {");
+    DebugInfo *debugInfo = Compilation::current().debugInfo;
+    string debugAttachment = debugInfo ? debugInfo->startFunction(this->getName(), this->retType, this->argTypes) : "";
+    string linkage = this->internal ? "internal fastcc " : "";
+    this->definitionAddress = buffer.emit("define " + linkage + retTypeStr + " @" + this->getName() + "(" + formalsStr.substr() + ")" + debugAttachment + " {");
     // I need to fix the hilighting of rainbow brackets so: }
     // Allocate space for 50 variables on the stack
+    SymbolTable &symbolTable = SymbolTable::instance();
     symbolTable.stackVariablesPtrReg = ralloc.getNextReg("FuncIdCStackVarPtrReg");
     buffer.emit("\t" + symbolTable.stackVariablesPtrReg + " = alloca i32, i32 50");
+    if (debugInfo) {
+        for (size_t i = 0; i < formals.size(); i++) {
+            debugInfo->declareFormal(formals[i]->getName(), formals[i]->getType(), i + 1, formals[i]->getRegisterName());
+        }
+    }
 }
 
-shared_ptr<FuncIdC> FuncIdC::startFuncIdWithScope(const string &name, shared_ptr<RetTypeNameC> type, const vector<shared_ptr<IdC>> &formals) {
-    auto funcId = NEW(FuncIdC, (name, type->getTypeName(), formals));
+FuncIdC::FuncIdC(SymbolId funcId, TypeName type, const vector<TypeName> &argTypes)
+    : IdC(funcId, TypeName::BAD_VIRTUAL_CALL),
+      argTypes(argTypes),
+      mapFormalNameToReg(),
+      retType(type),
+      internal(this->getName() != "main"),
+      effects(NO_EFFECTS),
+      definitionAddress(-1) {}
+
+shared_ptr<FuncIdC> FuncIdC::startFuncIdWithScope(SymbolId name, const RetTypeNameC &type, const vector<shared_ptr<IdC>> &formals) {
+    auto &symbolTable = SymbolTable::instance();
+    countStat(&CompileStats::functions);
+    CodeBuffer::instance().startFunctionStrings();
+    if (FunctionCache *functionCache = Compilation::current().functionCache) {
+        functionCache->startFunction();
+    }
+    if (activeTrace) {
+        activeTrace->begin("function " + Interner::instance().getName(name), "function");
+    }
+    auto funcId = NEW(FuncIdC, (name, type.getTypeName(), formals));
     symbolTable.addSymbol(funcId);
+    symbolTable.currentFunction = name;
+    symbolTable.currentFunctionRecurses = false;
+    symbolTable.currentFunctionEffects = NO_EFFECTS;
+    if (Profile *profile = Compilation::current().profile) {
+        profile->startFunction(funcId->getName());
+    }
 
     symbolTable.addScope(formals.size());
     for (auto i = 0; i < formals.size(); i++) {
         symbolTable.addFormal(formals[i]);
     }
-    symbolTable.retType = type;
+    symbolTable.retType = NEW(RetTypeNameC, (type));
     return funcId;
 }
 
+// The attributes of a function with effects. Nothing in FanC unwinds, and the call graph is only a DAG with self
+// loops, since functions are declared before they are used, so a function recurses only if it calls itself
+static string getFunctionAttributes(int effects, bool recurses) {
+    string attributes = "nounwind";
+    if (not(effects & (PRINTS | EXITS | WRITES_GLOBALS))) {
+        attributes += " readnone";
+    }
+    if (not(effects & (EXITS | MAY_RUN_FOREVER))) {
+        attributes += " willreturn";
+    }
+    if (not recurses) {
+        attributes += " norecurse";
+    }
+    return attributes;
+}
+
 void FuncIdC::endFuncIdScope() {
+    auto &symbolTable = SymbolTable::instance();
     symbolTable.removeScope();
-    string retTypeLlvm = typeNameToLlvmType(symbolTable.retType->getTypeName());
-    string defaultRetVal = retTypeLlvm + (retTypeLlvm == "void" ? "" : " 0");
+    TypeName retType = symbolTable.retType->getTypeName();
+    string defaultRetVal = typeNameToLlvmType(retType) + (retType == TypeName::VOID ? "" : " 0");
     symbolTable.retType = nullptr;
     auto &codeBuffer = CodeBuffer::instance();
+    if (Profile *profile = Compilation::current().profile) {
+        profile->beforeReturn();
+        symbolTable.currentFunctionEffects |= WRITES_GLOBALS;
+    }
     codeBuffer.emit("ret " + defaultRetVal);
+    codeBuffer.emitColdCode();
+    symbolTable.weightReturnGuards();
+    auto funcId = symbolTable.getFuncSymbol(symbolTable.currentFunction, false);
+    Memoizer *memoizer = Compilation::current().memoizer;
+    const bool memoize = memoizer and memoizer->shouldMemoize(*funcId, symbolTable.currentFunctionEffects, symbolTable.currentFunctionRecurses);
+    if (memoize) {
+        // Callers see the wrapper, which fills its table
+        symbolTable.currentFunctionEffects |= WRITES_GLOBALS;
+    }
+    funcId->setEffects(symbolTable.currentFunctionEffects);
+    codeBuffer.setFunctionAttributes(funcId->definitionAddress, getFunctionAttributes(symbolTable.currentFunctionEffects, symbolTable.currentFunctionRecurses));
+    symbolTable.currentFunction = -1;
     // To balance rainbow brackets {
     codeBuffer.emit("}");
     codeBuffer.emit("");
+    if (DebugInfo *debugInfo = Compilation::current().debugInfo) {
+        debugInfo->endFunction();
+    }
+    if (memoize) {
+        memoizer->emitWrapper(*funcId, funcId->definitionAddress);
+    } else if (Specializer *specializer = Compilation::current().specializer) {
+        if (funcId->isInternal()) {
+            specializer->addFunction(*funcId, funcId->definitionAddress);
+        }
+    }
+    if (FunctionCache *functionCache = Compilation::current().functionCache) {
+        functionCache->endFunction();
+    }
+    if (activeTrace) {
+        activeTrace->end();
+        traceBufferSize(codeBuffer);
+    }
 }
 
-const string &FuncIdC::getType() const {
+TypeName FuncIdC::getType() const {
     return this->retType;
 }
 
-const vector<string> &FuncIdC::getArgTypes() const {
-    return this->argTypes;
+bool FuncIdC::isFunc() const {
+    return true;
 }
 
-vector<string> &FuncIdC::getArgTypes() {
-    return this->argTypes;
+bool FuncIdC::isInternal() const {
+    return this->internal;
 }
 
-const string &RetTypeNameC::getTypeName() const {
-    return this->type;
+int FuncIdC::getEffects() const {
+    return this->effects;
 }
 
-// Helper functions
-
-static vector<shared_ptr<ExpC>> &assureExpCList(shared_ptr<STypeC> listStype) {
-    if (listStype == nullptr) {
-        throw Exception("nullptr can't be assured as ExpCList");
-    }
-
-    shared_ptr<StdType<vector<shared_ptr<ExpC>>>> expList = dynamic_pointer_cast<StdType<vector<shared_ptr<ExpC>>>>(listStype);
-    if (expList == nullptr) {
-        throw Exception("Expected list of expressions");
-    }
-    return expList->getValue();
+void FuncIdC::setEffects(int effects) {
+    this->effects = effects;
 }
 
-shared_ptr<ExpC> assureExpC(shared_ptr<STypeC> expStype) {
-    if (expStype == nullptr) {
-        throw Exception("nullptr can't be assured as ExpC");
-    }
-
-    auto exp = DC(ExpC, expStype);
-    if (expStype == nullptr) {
-        throw Exception("Failed to assure ExpC from Stype");
-    }
-    if (exp->getType() == "SC_BOOL") {
-        throw Exception("Got ExpC which is actually SC_BOOL. You probably don't want to use it like that");
-    }
+const vector<TypeName> &FuncIdC::getArgTypes() const {
+    return this->argTypes;
+}
 
-    return exp;
+vector<TypeName> &FuncIdC::getArgTypes() {
+    return this->argTypes;
 }
 
-shared_ptr<STypeC> handleExpList(shared_ptr<STypeC> expStype, shared_ptr<STypeC> listStype) {
-    if (listStype == nullptr) {
-        listStype = NEWSTD(vector<shared_ptr<ExpC>>);
-    }
-    auto &list = assureExpCList(listStype);
-    auto exp = assureExpC(expStype);
-    list.push_back(exp);
-    return listStype;
+TypeName RetTypeNameC::getTypeName() const {
+    return this->type;
 }
 
-bool isImpliedCastAllowed(shared_ptr<STypeC> rawExp1, shared_ptr<STypeC> rawExp2) {
-    auto exp1 = DC(ExpC, rawExp1);
-    auto exp2 = DC(ExpC, rawExp2);
+// Helper functions
 
-    bool isExp1IntOrByte = exp1->isByte() or exp1->isInt();
-    bool isExp2IntOrByte = exp2->isByte() or exp2->isInt();
+bool isImpliedCastAllowed(const ExpC &exp1, const ExpC &exp2) {
+    bool isExp1IntOrByte = exp1.isByte() or exp1.isInt();
+    bool isExp2IntOrByte = exp2.isByte() or exp2.isInt();
 
     bool canCastImplicitly = isExp1IntOrByte and isExp2IntOrByte;
 
     return canCastImplicitly;
 }
 
-bool areStrTypesCompatible(const string &typeStr1, const string &typeStr2) {
-    bool areEqual = typeStr1 == typeStr2;
-    bool areIntAndByte = typeStr1 == "INT" and typeStr2 == "BYTE";
-
-    bool canCastImplicitly = areEqual or areIntAndByte;
-
-    return canCastImplicitly;
-}
-
-void verifyBoolType(shared_ptr<STypeC> exp) {
-    auto expType = DC(ExpC, exp);
-    if (not expType->isBool()) {
-        errorMismatch(yylineno);
-    }
-}
-
-string typeNameToLlvmType(const string &typeName) {
-    if (typeName == "VOID") {
-        return "void";
-    } else if (typeName == "INT") {
-        return "i32";
-    } else if (typeName == "BYTE") {
-        return "i8";
-    } else if (typeName == "BOOL") {
-        return "i1";
-    } else if (typeName == "STRING") {
-        return "i8*";
-    } else {
-        throw Exception("Unsupported return type");
-    }
-}
-
-const string &verifyAllTypeNames(const string &type) {
-    if (type == "INT" or type == "BOOL" or type == "SC_BOOL" or type == "BYTE" or type == "VOID" or type == "STRING" or type == "BAD_VIRTUAL_CALL") {
-        return type;
-    } else {
+void verifyBoolType(const ExpC &exp) {
+    if (not exp.isBool()) {
         errorMismatch(yylineno);
     }
-    // Never reaches here because errorMismatch exits
-    return type;
 }
 
-const string &verifyValTypeName(const string &type) {
-    if (verifyAllTypeNames(type) != "VOID") {
-        return type;
-    } else {
+TypeName verifyValTypeName(TypeName type) {
+    if (not getTypeInfo(type).isValue) {
         errorMismatch(yylineno);
     }
-    // Never reaches here because errorMismatch exits
     return type;
 }
 
-const string &verifyRetTypeName(const string &type) {
-    if (verifyAllTypeNames(type) != "STRING") {
-        return type;
-    } else {
+TypeName verifyRetTypeName(TypeName type) {
+    if (not getTypeInfo(type).isRetType) {
         errorMismatch(yylineno);
     }
-    // Never reaches here because errorMismatch exits
     return type;
 }
 
-const string &verifyVarTypeName(const string &type) {
-    if (verifyAllTypeNames(type) != "VOID") {
-        return type;
-    } else {
-        errorMismatch(yylineno);
-    }
-    // Never reaches here because errorMismatch exits
-    return type;
+TypeName verifyVarTypeName(TypeName type) {
+    return verifyValTypeName(type);
 }
 
-static shared_ptr<ShortCircuitBool> lastScBool = nullptr;
-
-shared_ptr<ShortCircuitBool> saveScBool(shared_ptr<STypeC> scBoolStype) {
-    lastScBool = assureScBool(scBoolStype);
-    return lastScBool;
+void saveScBool(const ShortCircuitBool &scBool) {
+    Compilation::current().lastScBool = scBool;
 }
 
-shared_ptr<ShortCircuitBool> getLastScBool() {
-    auto boolExp = lastScBool;
-    lastScBool = nullptr;
-    return boolExp;
+ShortCircuitBool &getLastScBool() {
+    return Compilation::current().lastScBool;
 }
 
 // Handle if/loops open/close
 
-shared_ptr<ShortCircuitBool> assureScBool(shared_ptr<STypeC> scBoolStype) {
-    if (scBoolStype == nullptr) {
-        throw Exception("nullptr can't be assured as ShortCircuitBool");
-    }
-    auto scBool = DC(ShortCircuitBool, scBoolStype);
-    if (scBool == nullptr) {
-        throw Exception("Can't assure ScBool");
-    }
-
-    return scBool;
-}
-
-void handleIfStart(shared_ptr<STypeC> scBoolStype) {
-    auto scBool = assureScBool(scBoolStype);
+string handleIfStart(ShortCircuitBool &scBool) {
     auto &buffer = CodeBuffer::instance();
-    auto trueList = scBool->getTrueList();
     string trueLabel = buffer.genLabel("ifStatementStart");
-    buffer.bpatch(trueList, trueLabel);
+    buffer.bpatch(scBool.getTrueList(), trueLabel);
+    return trueLabel;
+}
+
+// Whether the last emitted instruction is a return
+static bool endsWithReturn(const CodeBuffer &buffer) {
+    const string &line = buffer.getCodeLine(buffer.getCodeSize() - 1);
+    return line.compare(line.find_first_not_of('\t'), 4, "ret ") == 0;
 }
 
-shared_ptr<STypeC> handleIfEnd(shared_ptr<STypeC> scBoolStype, bool hasElse) {
-    auto scBool = assureScBool(scBoolStype);
+AddressIndPair handleIfEnd(ShortCircuitBool &scBool, bool hasElse) {
     auto &buffer = CodeBuffer::instance();
-    shared_ptr<STypeC> brEndElseInstrStype = nullptr;
+    AddressIndPair brEndElseInstr = make_pair(-1, FIRST);
 
     if (hasElse) {
-        AddressIndPair brEndElseInstr = make_pair(buffer.emit("br label @"), FIRST);
-        brEndElseInstrStype = NEWSTD_V(AddressIndPair, (brEndElseInstr));
+        brEndElseInstr = make_pair(buffer.emit("br label @"), FIRST);
+    } else if (endsWithReturn(buffer)) {
+        SymbolTable::instance().addReturnGuard(scBool.getFalseList());
     }
 
-    auto falseList = scBool->getFalseList();
-
     string falseLabel = buffer.genLabel("ifEnd");
-    buffer.bpatch(falseList, falseLabel);
+    buffer.bpatch(scBool.getFalseList(), falseLabel);
 
-    return brEndElseInstrStype;
+    return brEndElseInstr;
 }
 
-void handleElseEnd(shared_ptr<STypeC> endIfListStype) {
-    AddressIndPair &endIfInstr = STYPE2STD(AddressIndPair, endIfListStype);
+void handleElseEnd(AddressIndPair endIfInstr) {
     auto &buffer = CodeBuffer::instance();
 
     string elseEndLabel = buffer.genLabel("elseEnd");
@@ -743,18 +714,18 @@ void handleElseEnd(shared_ptr<STypeC> endIfListStype) {
     buffer.bpatch(endIfInstr, elseEndLabel);
 }
 
-void handleWhileStart(shared_ptr<STypeC> scBoolStype, string startLabel) {
-    handleIfStart(scBoolStype);
-    symbolTable.startLoop(startLabel);
+void handleWhileStart(ShortCircuitBool &scBool, const string &startLabel) {
+    string bodyLabel = handleIfStart(scBool);
+    SymbolTable::instance().startLoop(startLabel, bodyLabel);
 }
 
-void handleWhileEnd(shared_ptr<STypeC> scBoolStype) {
-    auto scBool = assureScBool(scBoolStype);
-
+void handleWhileEnd(ShortCircuitBool &scBool) {
+    TraceSpan span("close loop");
+    auto &symbolTable = SymbolTable::instance();
     symbolTable.addContinue();
 
     /* `endLoop` must be called after we emit the br to jump to the beginning of the
      * condition (becuase endLoop will generate the endLabel to which we jump from the falseList and break statements)
      */
-    symbolTable.endLoop(scBool->getFalseList());
+    symbolTable.endLoop(scBool.getFalseList());
 }
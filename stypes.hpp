@@ -5,9 +5,12 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "bp.hpp"
+#include "interner.hpp"
+#include "types.hpp"
 
 using std::exception;
 using std::map;
@@ -15,23 +18,11 @@ using std::shared_ptr;
 using std::string;
 using std::vector;
 
-typedef enum {
-    STStatements,
-    STStatement,
-    STExpression,
-    STId,
-    STCall,
-    STString,
-    STStd,
-    STRetType
-} SymbolType;
-
 typedef int Offset;
 
-const string &verifyAllTypeNames(const string &type);
-const string &verifyValTypeName(const string &type);
-const string &verifyRetTypeName(const string &type);
-const string &verifyVarTypeName(const string &type);
+TypeName verifyValTypeName(TypeName type);
+TypeName verifyRetTypeName(TypeName type);
+TypeName verifyVarTypeName(TypeName type);
 
 struct Exception : public std::exception {
     string s;
@@ -40,156 +31,143 @@ struct Exception : public std::exception {
     const char *what() const throw() { return s.c_str(); }
 };
 
-class STypeC {
-    SymbolType symType;
-
-   public:
-    STypeC(SymbolType symType);
-    virtual ~STypeC() = default;
-};
-
-typedef shared_ptr<STypeC> STypePtr;
-
-class RetTypeNameC : public STypeC {
-    string type;
+class RetTypeNameC {
+    TypeName type = TypeName::VOID;
 
    public:
-    const string &getTypeName() const;
-    RetTypeNameC(const string &type);
+    RetTypeNameC() = default;
+    TypeName getTypeName() const;
+    RetTypeNameC(TypeName type);
 };
 
 class VarTypeNameC : public RetTypeNameC {
    public:
-    VarTypeNameC(const string &type);
+    VarTypeNameC() = default;
+    VarTypeNameC(TypeName type);
 };
 
-class IdC : public STypeC {
-    string name;
-    string type;
+class IdC {
+    SymbolId id;
+    TypeName type;
     string registerName;
 
    public:
     Offset offset;
 
-    IdC(const string &varName, const string &type);
+    IdC(SymbolId varId, TypeName type);
+    virtual ~IdC() = default;
+    SymbolId getId() const;
     const string &getName() const;
-    virtual const string &getType() const;
+    virtual TypeName getType() const;
+    // Symbols are either variables or functions, so no RTTI is needed to tell them apart
+    virtual bool isFunc() const;
     void setOffset(Offset offset);
     Offset getOffset() const;
     const string &getRegisterName() const;
     void setRegisterName(string registerName);
 };
 
+// What calling a function may do besides computing its result, as flags. Inferred from its code and the effects of
+// what it calls, and told to LLVM as the attributes of the function
+enum FunctionEffect {
+    NO_EFFECTS = 0,
+    PRINTS = 1,
+    // Exits the program instead of returning, like on a division by zero
+    EXITS = 2,
+    // Has loops or recursion, so it can't be told to terminate
+    MAY_RUN_FOREVER = 4,
+    // Writes globals, like the counters of --profile
+    WRITES_GLOBALS = 8,
+};
+
 class FuncIdC : public IdC {
-    vector<string> argTypes;
+    vector<TypeName> argTypes;
     map<string, string> mapFormalNameToReg;
-    string retType;
+    TypeName retType;
+    // Every function but main and the predefined ones is only called from the program, with the fastcc convention
+    bool internal;
+    int effects;
+    // Location of the define line in the code buffer, or -1
+    int definitionAddress;
 
    public:
-    FuncIdC(const string &name, const string &type, const vector<shared_ptr<IdC>> &formals, bool isPredefined = false);
-    const vector<string> &getArgTypes() const;
-    vector<string> &getArgTypes();
-    const string &getType() const;
+    FuncIdC(SymbolId funcId, TypeName type, const vector<shared_ptr<IdC>> &formals, bool isPredefined = false);
+    // Declare a function whose code was already emitted, like one spliced in by the function cache
+    FuncIdC(SymbolId funcId, TypeName type, const vector<TypeName> &argTypes);
+    const vector<TypeName> &getArgTypes() const;
+    vector<TypeName> &getArgTypes();
+    TypeName getType() const;
+    bool isFunc() const;
+    bool isInternal() const;
+    // The FunctionEffect flags of the function. Only complete once its code is
+    int getEffects() const;
+    void setEffects(int effects);
     // Create FuncIdC with opening a scope
-    static shared_ptr<FuncIdC> startFuncIdWithScope(const string &name, shared_ptr<RetTypeNameC> type, const vector<shared_ptr<IdC>> &formals);
+    static shared_ptr<FuncIdC> startFuncIdWithScope(SymbolId funcId, const RetTypeNameC &type, const vector<shared_ptr<IdC>> &formals);
     static void endFuncIdScope();
 };
 
-class ExpC : public STypeC {
-    string type;
+class ExpC {
+    TypeName type = TypeName::VOID;
     string registerOrImmediate;
 
-    // string expStartLabel;
-
    public:
-    ExpC(const string &type, const string &reg);
-    const string &getType() const;
+    // An empty expression is the result of calling a VOID function
+    ExpC() = default;
+    ExpC(TypeName type, const string &reg);
+    TypeName getType() const;
+    bool isEmpty() const;
     bool isInt() const;
     bool isBool() const;
     bool isString() const;
     bool isByte() const;
 
-    // string getExpStartLabel() const;
-    string getRegOrImmResult();
+    const string &getRegOrImmResult() const;
 
     // Get result of bin operation on two expressions
-    static shared_ptr<ExpC> getBinOpResult(shared_ptr<STypeC> stype1, shared_ptr<STypeC> stype2, int op);
-    // Get shared_ptr<ExpC> by casting exp from srcType to dstType
-    static shared_ptr<ExpC> getCastResult(shared_ptr<STypeC> dstStype, shared_ptr<STypeC> expStype);
-    // Get shared_ptr<ExpC> from a function call
-    static shared_ptr<ExpC> getCallResult(shared_ptr<FuncIdC> funcIdStype, shared_ptr<STypeC> argsStype);
-    // Get shared_ptr<ExpC> from variable ID
-    static shared_ptr<ExpC> loadIdValue(shared_ptr<IdC> idSymbol, string stackVariablesPtrReg);
-    // Get shared_ptr<ExpC> from string literal
-    static shared_ptr<ExpC> loadStringLiteralAddr(string literal);
-    // Get shared_ptr<ExpC> from the result of comparing this and otherScExp
-    static shared_ptr<ExpC> getCmpResult(shared_ptr<STypeC> stype1, shared_ptr<STypeC> stype2, int op);
+    static ExpC getBinOpResult(const ExpC &exp1, const ExpC &exp2, int op);
+    // Get ExpC by casting exp from srcType to dstType
+    static ExpC getCastResult(const VarTypeNameC &dstType, const ExpC &exp);
+    // Get ExpC from a function call
+    static ExpC getCallResult(shared_ptr<FuncIdC> funcId, const vector<ExpC> &args);
+    // Get ExpC from variable ID
+    static ExpC loadIdValue(shared_ptr<IdC> idSymbol, const string &stackVariablesPtrReg);
+    // Get ExpC from string literal (a view of the quoted literal in the source)
+    static ExpC loadStringLiteralAddr(std::string_view quotedLiteral);
+    // Get ExpC from the result of comparing exp1 and exp2
+    static ExpC getCmpResult(const ExpC &exp1, const ExpC &exp2, int op);
 };
 
-class ShortCircuitBool : public ExpC, public std::enable_shared_from_this<ShortCircuitBool> {
+class ShortCircuitBool {
     // Used only by bool expressions
     AddressList boolFalseList;
     AddressList boolTrueList;
 
    public:
+    ShortCircuitBool() = default;
     ShortCircuitBool(const AddressList &trueList, const AddressList &falseList);
-    ShortCircuitBool(shared_ptr<ExpC> boolExp);
+    explicit ShortCircuitBool(const ExpC &boolExp);
 
-    // Short-Circuit eval bool value
-    shared_ptr<ShortCircuitBool> evalBool(shared_ptr<STypeC> otherScExpStype, shared_ptr<STypeC> rightOperandStartStype, int op);
+    // Short-Circuit eval bool value. otherScExp is ignored for NOT
+    void evalBool(ShortCircuitBool *otherScExp, const string &rightOperandStartLabel, int op);
 
     AddressList &getFalseList();
     AddressList &getTrueList();
-    shared_ptr<ExpC> finallizeToExpC();
-
-    // Ansure there's a true and false lists. If either is zero, force concrete value for the expression and create conditional jump and add placeholders to falselist
-    // void ensureTrueFalseList();
-};
-
-class CallC : public STypeC {
-    string type;
-    string symbol;
-
-   public:
-    CallC(const string &type, const string &symbol);
-    const string &getType() const;
-};
-
-template <typename T>
-class StdType : public STypeC {
-    T value;
-
-   public:
-    StdType(T value) : STypeC(STStd), value(value){};
-    const T &getValue() const { return value; };
-    T &getValue() { return value; };
-    // const T &operator()() const { return value; };
-    // T &operator()() { return value; };
+    ExpC finallizeToExpC();
 };
 
 // helper functions:
-shared_ptr<STypeC> handleExpList(shared_ptr<STypeC> exp, shared_ptr<STypeC> list);
-bool isImpliedCastAllowed(shared_ptr<STypeC> rawExp1, shared_ptr<STypeC> rawExp2);
-bool areStrTypesCompatible(const string &typeStr1, const string &typeStr2);
-void verifyBoolType(shared_ptr<STypeC> exp);
-string typeNameToLlvmType(const string &typeName);
-void handleIfStart(shared_ptr<STypeC> conditionStype);
-shared_ptr<STypeC> handleIfEnd(shared_ptr<STypeC> conditionStype, bool hasElse = false);
-void handleElseEnd(shared_ptr<STypeC> endIfListStype);
-void handleWhileStart(shared_ptr<STypeC> conditionStype, string startLabel);
-void handleWhileEnd(shared_ptr<STypeC> endIfListStype);
-// Retain last bool ExpC in a static variable for later use
-shared_ptr<ShortCircuitBool> saveScBool(shared_ptr<STypeC> boolExpStype);
-shared_ptr<ShortCircuitBool> getLastScBool();
-shared_ptr<ExpC> assureExpC(shared_ptr<STypeC> expStype);
-shared_ptr<ShortCircuitBool> assureScBool(shared_ptr<STypeC> scBoolStype);
-
-#define YYSTYPE STypePtr
+bool isImpliedCastAllowed(const ExpC &exp1, const ExpC &exp2);
+void verifyBoolType(const ExpC &exp);
+string handleIfStart(ShortCircuitBool &scBool);
+AddressIndPair handleIfEnd(ShortCircuitBool &scBool, bool hasElse = false);
+void handleElseEnd(AddressIndPair endIfInstr);
+void handleWhileStart(ShortCircuitBool &scBool, const string &startLabel);
+void handleWhileEnd(ShortCircuitBool &scBool);
+// Retain last bool condition in the current compilation for later use
+void saveScBool(const ShortCircuitBool &scBool);
+ShortCircuitBool &getLastScBool();
+
 #define NEW(x, y) (std::shared_ptr<x>(new x y))
-#define NEWSTD(x) (std::shared_ptr<StdType<x>>(new StdType<x>(x())))
-#define NEWSTD_V(x, y) (std::shared_ptr<StdType<x>>(new StdType<x>(x y)))
-#define STYPE2STD(t, x) (dynamic_pointer_cast<StdType<t>>(x)->getValue())
-#define DC(t, x) (dynamic_pointer_cast<t>(x))
-#define VECS(x) STYPE2STD(vector<string>, x)
 
 #endif
\ No newline at end of file
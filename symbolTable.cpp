@@ -1,135 +1,218 @@
 #include "symbolTable.hpp"
 
+#include "compilation.hpp"
+#include "debugInfo.hpp"
 #include "hw3_output.hpp"
+#include "loops.hpp"
 #include "parser.tab.hpp"
+#include "profile.hpp"
 #include "ralloc.hpp"
+#include "stats.hpp"
 
 using namespace output;
 
 using std::get;
 
+// Print functions' implementation, emitted at the top of every program
+static const char *const RUNTIME_PRELUDE[] = {
+    "declare i32 @printf(i8*, ...)",
+    "declare void @exit(i32) noreturn nounwind",
+    "@.int_specifier = constant [4 x i8] c\"%d\\0A\\00\"",
+    "@.str_specifier = constant [4 x i8] c\"%s\\0A\\00\"",
+    "@.error_div_zero_msg = constant [23 x i8] c\"Error division by zero\\00\"",
+    "",
+    "define void @printi(i32) nounwind {",
+    "\t%spec_ptr = getelementptr [4 x i8], [4 x i8]* @.int_specifier, i32 0, i32 0",
+    "\tcall i32 (i8*, ...) @printf(i8* %spec_ptr, i32 %0)",
+    "\tret void",
+    "}",
+    "",
+    "define void @print(i8*) nounwind {",
+    "\t%spec_ptr = getelementptr [4 x i8], [4 x i8]* @.str_specifier, i32 0, i32 0",
+    "\tcall i32 (i8*, ...) @printf(i8* %spec_ptr, i8* %0)",
+    "\tret void",
+    "}",
+    "",
+    "define void @error_division_by_zero() cold noreturn nounwind {",
+    "\t%spec_ptr = getelementptr [23 x i8], [23 x i8]* @.error_div_zero_msg, i32 0, i32 0",
+    "\tcall void (i8*) @print(i8* %spec_ptr)",
+    "\tcall void (i32) @exit(i32 0)",
+    "\tunreachable",
+    "}",
+    "",
+    // The branch weights below, the first of each being the weight of the first label
+    "!0 = !{!\"branch_weights\", i32 1, i32 2000}",
+    "!1 = !{!\"branch_weights\", i32 124, i32 4}",
+    "!2 = !{!\"branch_weights\", i32 4, i32 124}",
+    "!3 = !{!\"branch_weights\", i32 3, i32 2}",
+    "!4 = !{!\"branch_weights\", i32 2, i32 3}",
+    "",
+};
+
+const int PRELUDE_METADATA_NODES = 5;
+const char *const ERROR_PATH_WEIGHTS = "!0";
+const char *const FIRST_LIKELY_WEIGHTS = "!1";
+const char *const SECOND_LIKELY_WEIGHTS = "!2";
+const char *const FIRST_MODERATELY_LIKELY_WEIGHTS = "!3";
+const char *const SECOND_MODERATELY_LIKELY_WEIGHTS = "!4";
+
+// Weight each branch of list towards its label that isn't the one it is in the list for
+static void weightAgainst(const AddressList &list, const char *firstWeights, const char *secondWeights) {
+    auto &buffer = CodeBuffer::instance();
+    for (auto &branch : list) {
+        if (branch.first != -1) {
+            buffer.setBranchWeights(branch.first, branch.second == SECOND ? firstWeights : secondWeights);
+        }
+    }
+}
+
 SymbolTable::SymbolTable() {
+    auto &interner = Interner::instance();
     this->nestedLoopDepth = 0;
     this->currOffset = 0;
+    this->currentFunction = -1;
+    this->currentFunctionRecurses = false;
+    this->currentFunctionEffects = NO_EFFECTS;
     this->addScope();
-    this->addSymbol(NEW(FuncIdC, ("print", "VOID", vector<shared_ptr<IdC>>({NEW(IdC, ("msg", "STRING"))}), true)));
-    this->addSymbol(NEW(FuncIdC, ("printi", "VOID", vector<shared_ptr<IdC>>({NEW(IdC, ("i", "INT"))}), true)));
-    this->addSymbol(NEW(FuncIdC, ("error_division_by_zero", "VOID", vector<shared_ptr<IdC>>({}), true)));
+    auto print = NEW(FuncIdC, (interner.intern("print"), TypeName::VOID, vector<shared_ptr<IdC>>({NEW(IdC, (interner.intern("msg"), TypeName::STRING))}), true));
+    auto printi = NEW(FuncIdC, (interner.intern("printi"), TypeName::VOID, vector<shared_ptr<IdC>>({NEW(IdC, (interner.intern("i"), TypeName::INT))}), true));
+    auto errorDivisionByZero = NEW(FuncIdC, (interner.intern("error_division_by_zero"), TypeName::VOID, vector<shared_ptr<IdC>>({}), true));
+    print->setEffects(PRINTS);
+    printi->setEffects(PRINTS);
+    errorDivisionByZero->setEffects(PRINTS | EXITS);
+    this->addSymbol(print);
+    this->addSymbol(printi);
+    this->addSymbol(errorDivisionByZero);
     // Emit print functions' implementation
     auto &buffer = CodeBuffer::instance();
-    buffer.emitGlobal("declare i32 @printf(i8*, ...)");
-    buffer.emitGlobal("declare void @exit(i32)");
-    buffer.emitGlobal("@.int_specifier = constant [4 x i8] c\"%d\\0A\\00\"");
-    buffer.emitGlobal("@.str_specifier = constant [4 x i8] c\"%s\\0A\\00\"");
-    buffer.emitGlobal("@.error_div_zero_msg = constant [23 x i8] c\"Error division by zero\\00\"");
-    buffer.emitGlobal("");
-    buffer.emitGlobal("define void @printi(i32) {");
-    buffer.emitGlobal("\t%spec_ptr = getelementptr [4 x i8], [4 x i8]* @.int_specifier, i32 0, i32 0");
-    buffer.emitGlobal("\tcall i32 (i8*, ...) @printf(i8* %spec_ptr, i32 %0)");
-    buffer.emitGlobal("\tret void");
-    buffer.emitGlobal("}");
-    buffer.emitGlobal("");
-    buffer.emitGlobal("define void @print(i8*) {");
-    buffer.emitGlobal("\t%spec_ptr = getelementptr [4 x i8], [4 x i8]* @.str_specifier, i32 0, i32 0");
-    buffer.emitGlobal("\tcall i32 (i8*, ...) @printf(i8* %spec_ptr, i8* %0)");
-    buffer.emitGlobal("\tret void");
-    buffer.emitGlobal("}");
-    buffer.emitGlobal("");
-    buffer.emitGlobal("define void @error_division_by_zero() {");
-    buffer.emitGlobal("\t%spec_ptr = getelementptr [23 x i8], [23 x i8]* @.error_div_zero_msg, i32 0, i32 0");
-    buffer.emitGlobal("\tcall void (i8*) @print(i8* %spec_ptr)");
-    buffer.emitGlobal("\tcall void (i32) @exit(i32 0)");
-    buffer.emitGlobal("\tret void");
-    buffer.emitGlobal("}");
-    buffer.emitGlobal("");
+    for (const char *line : RUNTIME_PRELUDE) {
+        buffer.emitGlobal(line);
+    }
 }
 
 SymbolTable::~SymbolTable() {}
 
+SymbolTable &SymbolTable::instance() {
+    return Compilation::current().symbolTable;
+}
+
 void SymbolTable::addScope(int funcArgCount) {
     if (not((funcArgCount >= 0 and this->scopeStartOffsets.size() == 1) or (this->scopeStartOffsets.size() > 1 and funcArgCount == 0) or this->scopeStartOffsets.size() == 0)) {
         throw Exception("Code error. We should only add a scope of a function when we are in the global scope");
     }
 
-    this->scopeSymbols.push_back(vector<string>());
+    this->scopeSymbolsStarts.push_back(this->scopeSymbols.size());
     this->scopeStartOffsets.push_back(this->currOffset);
 }
 
 void SymbolTable::removeScope() {
     // endScope();
 
+    auto &interner = Interner::instance();
     string funcTypeStr;
     shared_ptr<FuncIdC> funcId;
     vector<string> argTypes;
+    string typeStr;
+
+    size_t scopeStart = this->scopeSymbolsStarts.back();
 
     // If we are going back into the global scope
-    if (this->scopeSymbols.size() == 2) {
+    if (this->scopeSymbolsStarts.size() == 2) {
         this->currOffset = 0;
 
         // For each string in the last scope, remove it from the symbol table
         Offset offset = -1;
 
         for (int i = this->formals.size() - 1; i >= 0; i--) {
-            printID(this->formals[i], offset--, this->symTbl[this->formals[i]]->getType());
-            this->symTbl.erase(this->formals[i]);
+            printID(interner.getName(this->formals[i]), offset--, typeNameToString(this->symTbl[this->formals[i]]->getType()));
+            this->symTbl[this->formals[i]] = nullptr;
         }
 
         this->formals.clear();
     } else {
-        this->currOffset -= this->scopeSymbols.back().size();
+        this->currOffset -= this->scopeSymbols.size() - scopeStart;
     }
 
     Offset offset = this->scopeStartOffsets.back();
 
-    for (string s : this->scopeSymbols.back()) {
-        if ((funcId = DC(FuncIdC, this->symTbl[s])) != nullptr) {
-            funcTypeStr = makeFunctionType(funcId->getType(), funcId->getArgTypes());
-            printID(s, offset, funcTypeStr);
+    for (size_t i = scopeStart; i < this->scopeSymbols.size(); i++) {
+        SymbolId s = this->scopeSymbols[i];
+        if (this->symTbl[s]->isFunc()) {
+            funcId = std::static_pointer_cast<FuncIdC>(this->symTbl[s]);
+            argTypes = typeNamesToStrings(funcId->getArgTypes());
+            funcTypeStr = makeFunctionType(typeNameToString(funcId->getType()), argTypes);
+            printID(interner.getName(s), offset, funcTypeStr);
         } else {
-            printID(s, offset++, this->symTbl[s]->getType());
+            printID(interner.getName(s), offset++, typeNameToString(this->symTbl[s]->getType()));
         }
 
-        this->symTbl.erase(s);
+        // FanC doesn't allow shadowing, so there is no outer binding to restore
+        this->symTbl[s] = nullptr;
     }
 
-    scopeSymbols.pop_back();
+    scopeSymbols.resize(scopeStart);
+    scopeSymbolsStarts.pop_back();
     scopeStartOffsets.pop_back();
 }
 
+const shared_ptr<IdC> &SymbolTable::lookup(SymbolId id) const {
+    static const shared_ptr<IdC> notFound = nullptr;
+
+    if (id < 0 or (size_t)id >= this->symTbl.size()) {
+        return notFound;
+    }
+    return this->symTbl[id];
+}
+
+void SymbolTable::bind(SymbolId id, shared_ptr<IdC> symbol) {
+    if ((size_t)id >= this->symTbl.size()) {
+        size_t capacity = this->symTbl.capacity();
+        this->symTbl.resize(Interner::instance().size());
+        countGrowth(Subsystem::SYMBOL_TABLE, this->symTbl, capacity);
+    }
+    countAllocation(Subsystem::SYMBOL_TABLE, symbol->isFunc() ? sizeof(FuncIdC) : sizeof(IdC));
+    this->symTbl[id] = symbol;
+}
+
 void SymbolTable::addFormal(shared_ptr<IdC> type) {
     if (type == nullptr) {
         throw Exception("Can't add a nullptr formal to the symbol table");
     }
 
-    if (this->symTbl[type->getName()] != nullptr) {
+    if (this->lookup(type->getId()) != nullptr) {
         errorDef(yylineno, type->getName());
     }
 
-    this->formals.push_back(type->getName());
-    this->symTbl[type->getName()] = type;
+    this->formals.push_back(type->getId());
+    this->bind(type->getId(), type);
 }
 
 void SymbolTable::addSymbol(shared_ptr<IdC> type) {
-    const string &name = type->getName();
     // Check that the symbol doesn't exist in the scope yet
     if (type == nullptr) {
         throw Exception("Can't add a nullptr symbol to the symbol table");
     }
+    SymbolId id = type->getId();
 
-    if (type->getType() == "STRING") {
+    if (type->getType() == TypeName::STRING) {
         errorMismatch(yylineno);
     }
 
-    if (this->symTbl[name] != nullptr) {
-        errorDef(yylineno, name);
+    if (this->lookup(id) != nullptr) {
+        errorDef(yylineno, type->getName());
     }
 
-    this->scopeSymbols.back().push_back(name);
+    size_t capacity = this->scopeSymbols.capacity();
+    this->scopeSymbols.push_back(id);
+    countGrowth(Subsystem::SYMBOL_TABLE, this->scopeSymbols, capacity);
 
     type->setOffset(this->currOffset);
-    this->symTbl[name] = type;
+    this->bind(id, type);
 
     if (this->scopeStartOffsets.size() > 1) {
+        if (DebugInfo *debugInfo = Compilation::current().debugInfo) {
+            debugInfo->declareLocal(type->getName(), type->getType(), this->currOffset, this->stackVariablesPtrReg);
+        }
         this->currOffset++;
     }
 }
@@ -139,7 +222,10 @@ void SymbolTable::addContinue() {
         errorUnexpectedContinue(yylineno);
     }
     auto &buffer = CodeBuffer::instance();
-    buffer.emit("; DEBUG: " + to_string(yylineno) + ": adding continue statement for loop in depth " + to_string(this->nestedLoopDepth));
+    buffer.emit("; DEBUG: adding continue statement for loop in depth " + to_string(this->nestedLoopDepth));
+    if (Profile *profile = Compilation::current().profile) {
+        profile->countLoopIteration(this->loopLineStack.back());
+    }
     buffer.emit("br label %" + this->loopCondStartLabelStack.back());
 }
 
@@ -148,47 +234,91 @@ void SymbolTable::addBreak() {
         errorUnexpectedBreak(yylineno);
     }
     auto &buffer = CodeBuffer::instance();
-    buffer.emit("; DEBUG: " + to_string(yylineno) + ": adding break to loop in depth " + to_string(this->nestedLoopDepth));
+    buffer.emit("; DEBUG: adding break to loop in depth " + to_string(this->nestedLoopDepth));
     AddressIndPair instruction = make_pair(buffer.emit("br label @"), FIRST);
     this->breakListStack.back().push_back(instruction);
 }
 
-void SymbolTable::startLoop(const string &loopCondStartLabel) {
+void SymbolTable::addReturnGuard(const AddressList &skipList) {
+    this->returnGuards.insert(this->returnGuards.end(), skipList.begin(), skipList.end());
+}
+
+void SymbolTable::moveReturnGuards(int begin, int end, const vector<int> &copyAddresses) {
+    AddressList moved;
+    for (auto &guard : this->returnGuards) {
+        if (guard.first < begin or guard.first >= end) {
+            moved.push_back(guard);
+            continue;
+        }
+        for (int copyAddress : copyAddresses) {
+            moved.push_back(make_pair(copyAddress + guard.first - begin, guard.second));
+        }
+    }
+    this->returnGuards = moved;
+}
+
+void SymbolTable::weightReturnGuards() {
+    // The base case of a recursion is reached by a good part of the calls
+    if (this->currentFunctionRecurses) {
+        weightAgainst(this->returnGuards, FIRST_MODERATELY_LIKELY_WEIGHTS, SECOND_MODERATELY_LIKELY_WEIGHTS);
+    }
+    this->returnGuards.clear();
+}
+
+void SymbolTable::startLoop(const string &loopCondStartLabel, const string &loopBodyLabel) {
     this->nestedLoopDepth++;
     this->loopCondStartLabelStack.push_back(loopCondStartLabel);
+    this->loopBodyLabelStack.push_back(loopBodyLabel);
+    this->loopLineStack.push_back(yylineno);
+    this->currentFunctionEffects |= MAY_RUN_FOREVER;
     this->breakListStack.push_back(vector<AddressIndPair>());
 }
 
 void SymbolTable::endLoop(AddressList &falseList) {
     auto &buffer = CodeBuffer::instance();
+    Unroller *unroller = Compilation::current().unroller;
+    // The closed form of the loop, if it has one, leaves it like a break
+    int closedFormExit = emitClosedForm(this->loopCondStartLabelStack.back(), this->stackVariablesPtrReg);
+    if (closedFormExit != -1) {
+        this->breakListStack.back().push_back(make_pair(closedFormExit, FIRST));
+    } else if (not unroller or not unroller->unrollLoop(this->loopCondStartLabelStack.back(), this->stackVariablesPtrReg,
+                                                         falseList, this->breakListStack.back())) {
+        rotateLoop(this->loopCondStartLabelStack.back(), this->loopBodyLabelStack.back(), falseList);
+    }
     string endLoopLabel = buffer.genLabel("endLoopDepth" + to_string(this->nestedLoopDepth));
+    // Loops usually go around more than once, so staying in the loop is likely
+    weightAgainst(falseList, FIRST_LIKELY_WEIGHTS, SECOND_LIKELY_WEIGHTS);
     buffer.bpatch(this->breakListStack.back(), endLoopLabel);
     buffer.bpatch(falseList, endLoopLabel);
 
     this->breakListStack.pop_back();
     this->loopCondStartLabelStack.pop_back();
+    this->loopBodyLabelStack.pop_back();
+    this->loopLineStack.pop_back();
     this->nestedLoopDepth--;
 }
 
-shared_ptr<IdC> SymbolTable::getVarSymbol(const string &name) {
-    auto symbol = this->symTbl[name];
+shared_ptr<IdC> SymbolTable::getVarSymbol(SymbolId id) {
+    auto &symbol = this->lookup(id);
 
     // Check that the symbol exists in the symbol table
-    if (symbol == nullptr or DC(FuncIdC, symbol) != nullptr) {
-        errorUndef(yylineno, name);
+    if (symbol == nullptr or symbol->isFunc()) {
+        errorUndef(yylineno, Interner::instance().getName(id));
     }
 
     return symbol;
 }
 
-shared_ptr<FuncIdC> SymbolTable::getFuncSymbol(const string &name, bool shouldError) {
-    auto symbol = this->symTbl[name];
+shared_ptr<FuncIdC> SymbolTable::getFuncSymbol(SymbolId id, bool shouldError) {
+    auto &symbol = this->lookup(id);
 
     // Check that the symbol exists in the symbol table
     shared_ptr<FuncIdC> funcSym = nullptr;
 
-    if ((symbol == nullptr or (funcSym = DC(FuncIdC, symbol)) == nullptr) and shouldError) {
-        errorUndefFunc(yylineno, name);
+    if (symbol != nullptr and symbol->isFunc()) {
+        funcSym = std::static_pointer_cast<FuncIdC>(symbol);
+    } else if (shouldError) {
+        errorUndefFunc(yylineno, Interner::instance().getName(id));
     }
 
     return funcSym;
@@ -196,24 +326,23 @@ shared_ptr<FuncIdC> SymbolTable::getFuncSymbol(const string &name, bool shouldEr
 
 void SymbolTable::printSymbolTable() {
     Offset offset = 0;
-    for (auto it = this->symTbl.begin(); it != this->symTbl.end(); ++it) {
-        printID(it->first, offset++, it->second->getType());
+    for (auto &symbol : this->symTbl) {
+        if (symbol != nullptr) {
+            printID(symbol->getName(), offset++, typeNameToString(symbol->getType()));
+        }
     }
 }
 
 int SymbolTable::getCurrentScopeDepth() const {
-    return this->scopeSymbols.size() - 1;
+    return this->scopeSymbolsStarts.size() - 1;
 }
 
 // Helper functions
 
 void verifyMainExists(SymbolTable &symbolTable) {
-    auto token = yylex();
-    if (token) {
-    }
-    auto mainFunc = symbolTable.getFuncSymbol("main", false);
+    auto mainFunc = symbolTable.getFuncSymbol(Interner::instance().intern("main"), false);
 
-    if (mainFunc == nullptr or mainFunc->getType() != "VOID" or mainFunc->getArgTypes().size() != 0) {
+    if (mainFunc == nullptr or mainFunc->getType() != TypeName::VOID or mainFunc->getArgTypes().size() != 0) {
         errorMainMissing();
     }
 
@@ -221,21 +350,16 @@ void verifyMainExists(SymbolTable &symbolTable) {
 }
 
 // no need to "try" because we don't have a danger of conflicting types here
-void addUninitializedSymbol(SymbolTable &symbolTable, shared_ptr<STypeC> rawSymbol) {
-    shared_ptr<IdC> symbol = DC(IdC, rawSymbol);
-    shared_ptr<ExpC> zeroExp = NEW(ExpC, (symbol->getType(), "0"));
+void addUninitializedSymbol(SymbolTable &symbolTable, shared_ptr<IdC> symbol) {
+    ExpC zeroExp(symbol->getType(), "0");
 
     symbolTable.addSymbol(symbol);
 
     emitAssign(symbol, zeroExp, symbolTable.stackVariablesPtrReg);
 }
 
-void tryAddSymbolWithExp(SymbolTable &symbolTable, shared_ptr<STypeC> rawSymbol,
-                         shared_ptr<STypeC> rawExp) {
-    shared_ptr<IdC> symbol = DC(IdC, rawSymbol);
-    shared_ptr<ExpC> exp = DC(ExpC, rawExp);
-
-    if (not areStrTypesCompatible(symbol->getType(), exp->getType())) {
+void tryAddSymbolWithExp(SymbolTable &symbolTable, shared_ptr<IdC> symbol, const ExpC &exp) {
+    if (not areTypesCompatible(symbol->getType(), exp.getType())) {
         errorMismatch(yylineno);
     }
 
@@ -245,41 +369,34 @@ void tryAddSymbolWithExp(SymbolTable &symbolTable, shared_ptr<STypeC> rawSymbol,
 }
 
 // no need to "try" because we don't have a danger of conflicting types here
-void addAutoSymbolWithExp(SymbolTable &symbolTable, shared_ptr<STypeC> rawId,
-                          shared_ptr<STypeC> rawExp) {
-    string id = STYPE2STD(string, rawId);
-    shared_ptr<ExpC> exp = DC(ExpC, rawExp);
-    shared_ptr<IdC> symbol = NEW(IdC, (id, exp->getType()));
+void addAutoSymbolWithExp(SymbolTable &symbolTable, SymbolId id, const ExpC &exp) {
+    shared_ptr<IdC> symbol = NEW(IdC, (id, exp.getType()));
 
     symbolTable.addSymbol(symbol);  // now offset is set to symbol through shared ptr
 
     emitAssign(symbol, exp, symbolTable.stackVariablesPtrReg);
 }
 
-void tryAssignExp(SymbolTable &symbolTable, shared_ptr<STypeC> rawId, shared_ptr<STypeC> rawExp) {
-    string id = STYPE2STD(string, rawId);
+void tryAssignExp(SymbolTable &symbolTable, SymbolId id, const ExpC &exp) {
     shared_ptr<IdC> symbol = symbolTable.getVarSymbol(id);
-    shared_ptr<ExpC> exp = DC(ExpC, rawExp);
 
-    string symbolType = symbol->getType();
-    string expType = exp->getType();
-
-    if (not areStrTypesCompatible(symbolType, expType)) {
+    if (not areTypesCompatible(symbol->getType(), exp.getType())) {
         errorMismatch(yylineno);
     }
 
     emitAssign(symbol, exp, symbolTable.stackVariablesPtrReg);
 }
 
-void emitAssign(shared_ptr<IdC> symbol, shared_ptr<ExpC> exp, string stackVariablesPtrReg) {
+void emitAssign(shared_ptr<IdC> symbol, const ExpC &exp, const string &stackVariablesPtrReg) {
     CodeBuffer &codeBuffer = CodeBuffer::instance();
     Ralloc &ralloc = Ralloc::instance();
 
-    string llvmLvalType = typeNameToLlvmType(symbol->getType());
-    string llvmRvalType = typeNameToLlvmType(exp->getType());
+    TypeName lvalType = symbol->getType();
+    string llvmLvalType = typeNameToLlvmType(lvalType);
+    string llvmRvalType = typeNameToLlvmType(exp.getType());
     string offsetReg = ralloc.getNextReg("offsetEmitAssign_" + symbol->getName());
     string idAddrReg = ralloc.getNextReg("idAddrEmitAssign_" + symbol->getName());
-    string expReg = exp->getRegOrImmResult();
+    string expReg = exp.getRegOrImmResult();
 
     codeBuffer.emit(offsetReg + " = add i32 0, " + std::to_string(symbol->getOffset()));
     codeBuffer.emit(idAddrReg + " = getelementptr i32, i32* " + stackVariablesPtrReg + ", i32 " + offsetReg);
@@ -287,13 +404,13 @@ void emitAssign(shared_ptr<IdC> symbol, shared_ptr<ExpC> exp, string stackVariab
     string idAddrRegCorrectSize = idAddrReg;
 
     // Check and zext if needed
-    if (llvmRvalType != llvmLvalType) {
+    if (exp.getType() != lvalType) {
         string zextExpReg = ralloc.getNextReg("zextEmitAssign_" + symbol->getName());
         codeBuffer.emit(zextExpReg + " = zext " + llvmRvalType + " " + expReg + " to " + llvmLvalType);
         expReg = zextExpReg;
     }
 
-    if (llvmLvalType != "i32") {
+    if (lvalType != TypeName::INT) {
         idAddrRegCorrectSize = ralloc.getNextReg("idAddrCorrect_" + symbol->getName());
         codeBuffer.emit(idAddrRegCorrectSize + " = bitcast i32* " + idAddrReg + " to " + llvmLvalType + "*");
     }
@@ -304,31 +421,33 @@ void emitAssign(shared_ptr<IdC> symbol, shared_ptr<ExpC> exp, string stackVariab
 void handleReturn(shared_ptr<RetTypeNameC> retType) {
     if (retType == nullptr) {
         throw Exception("This should be impossible. Syntax error wise");
-    } else if (retType->getTypeName() != "VOID") {
+    } else if (retType->getTypeName() != TypeName::VOID) {
         errorMismatch(yylineno);
     }
 
     emitReturn(retType, nullptr);
 }
 
-void handleReturnExp(shared_ptr<RetTypeNameC> retType, shared_ptr<STypeC> rawExp) {
-    shared_ptr<ExpC> exp = DC(ExpC, rawExp);
-    exp->getRegOrImmResult();
+void handleReturnExp(shared_ptr<RetTypeNameC> retType, const ExpC &exp) {
+    exp.getRegOrImmResult();
 
     if (retType == nullptr) {
         throw Exception("This should be impossible. Syntax error wise");
-    } else if (not areStrTypesCompatible(retType->getTypeName(), exp->getType())) {
+    } else if (not areTypesCompatible(retType->getTypeName(), exp.getType())) {
         errorMismatch(yylineno);
     }
 
-    emitReturn(retType, exp);
+    emitReturn(retType, &exp);
 }
 
-void emitReturn(shared_ptr<RetTypeNameC> retType, shared_ptr<ExpC> exp) {
+void emitReturn(shared_ptr<RetTypeNameC> retType, const ExpC *exp) {
     CodeBuffer &codeBuffer = CodeBuffer::instance();
+    if (Profile *profile = Compilation::current().profile) {
+        profile->beforeReturn();
+    }
 
     if (exp == nullptr) {
-        if (retType->getTypeName() != "VOID") {
+        if (retType->getTypeName() != TypeName::VOID) {
             errorMismatch(yylineno);
         }
         codeBuffer.emit("ret void");
@@ -1,59 +1,91 @@
 #ifndef SYMBOL_TABLE_HPP_
 #define SYMBOL_TABLE_HPP_
 
-#include <map>
 #include <memory>
 #include <string>
 
 #include "stypes.hpp"
 
-using std::map;
 using std::shared_ptr;
 using std::string;
 
+// Branch weights metadata defined in the prelude, for CodeBuffer::setBranchWeights. Very unlikely to take the first
+// label, likely to take the first/second label, and moderately likely to
+extern const char *const ERROR_PATH_WEIGHTS;
+extern const char *const FIRST_LIKELY_WEIGHTS;
+extern const char *const SECOND_LIKELY_WEIGHTS;
+extern const char *const FIRST_MODERATELY_LIKELY_WEIGHTS;
+extern const char *const SECOND_MODERATELY_LIKELY_WEIGHTS;
+// Number of metadata nodes the prelude defines. Other metadata is numbered after them
+extern const int PRELUDE_METADATA_NODES;
+
 class SymbolTable {
-    map<string, shared_ptr<IdC>> symTbl;
+    // Indexed by SymbolId. Ids are dense, so this is a collision free hash table
+    vector<shared_ptr<IdC>> symTbl;
     vector<Offset> scopeStartOffsets;
-    vector<string> formals;
-    vector<vector<string>> scopeSymbols;
+    vector<SymbolId> formals;
+    // Undo log of the symbols added in all open scopes, and where each scope starts in it
+    vector<SymbolId> scopeSymbols;
+    vector<size_t> scopeSymbolsStarts;
+
+    // Get the symbol bound to id, or nullptr. Never inserts
+    const shared_ptr<IdC> &lookup(SymbolId id) const;
+    void bind(SymbolId id, shared_ptr<IdC> symbol);
 
     // For loops
     vector<AddressList> breakListStack;
     vector<string> loopCondStartLabelStack;
+    vector<string> loopBodyLabelStack;
+    vector<int> loopLineStack;
     Offset currOffset;
 
+    // Branches around the ifs of the current function whose bodies end with a return
+    AddressList returnGuards;
+
    public:
     shared_ptr<RetTypeNameC> retType;
     string stackVariablesPtrReg;
     int nestedLoopDepth;
+    // The function being lowered, or -1, whether it calls itself, and its FunctionEffect flags so far
+    SymbolId currentFunction;
+    bool currentFunctionRecurses;
+    int currentFunctionEffects;
     SymbolTable();
     ~SymbolTable();
+    // Get the symbol table of the current compilation
+    static SymbolTable &instance();
     void addScope(int funcArgCount = 0);
     void removeScope();
     void addSymbol(shared_ptr<IdC> type);
     void addFormal(shared_ptr<IdC> type);
     void addContinue();
     void addBreak();
-    void startLoop(const string &loopCondStart);
+    // Remember the branches skipping an if body that ends with a return, given its false list
+    void addReturnGuard(const AddressList &skipList);
+    // The code from begin up to end, at the end of the function, was replaced by copies of it starting at each of
+    // copyAddresses: move the return guards in it onto each copy
+    void moveReturnGuards(int begin, int end, const vector<int> &copyAddresses);
+    // At the end of a function, weight its return guards if it is recursive
+    void weightReturnGuards();
+    void startLoop(const string &loopCondStart, const string &loopBody);
     void endLoop(AddressList &falseList);
     // pair<AddressList, AddressList> getBreakAndContAddrLists();
-    shared_ptr<IdC> getVarSymbol(const string &name);
-    shared_ptr<FuncIdC> getFuncSymbol(const string &name, bool shouldError = true);
+    shared_ptr<IdC> getVarSymbol(SymbolId id);
+    shared_ptr<FuncIdC> getFuncSymbol(SymbolId id, bool shouldError = true);
     void printSymbolTable();
     int getCurrentScopeDepth() const;
 };
 
 void verifyMainExists(SymbolTable &symbolTable);
-void tryAddSymbolWithExp(SymbolTable &symbolTable, shared_ptr<STypeC> rawSymbol,
-                         shared_ptr<STypeC> rawExp);
-void addAutoSymbolWithExp(SymbolTable &symbolTable, shared_ptr<STypeC> rawId,
-                          shared_ptr<STypeC> rawExp);
-void tryAssignExp(SymbolTable &symbolTable, shared_ptr<STypeC> rawId, shared_ptr<STypeC> rawExp);
-
-void emitAssign(shared_ptr<IdC> symbol, shared_ptr<ExpC> exp, string stackVariablesPtrReg);
-void addUninitializedSymbol(SymbolTable &symbolTable, shared_ptr<STypeC> rawSymbol);
+void tryAddSymbolWithExp(SymbolTable &symbolTable, shared_ptr<IdC> symbol, const ExpC &exp);
+void addAutoSymbolWithExp(SymbolTable &symbolTable, SymbolId id, const ExpC &exp);
+void tryAssignExp(SymbolTable &symbolTable, SymbolId id, const ExpC &exp);
+
+void emitAssign(shared_ptr<IdC> symbol, const ExpC &exp, const string &stackVariablesPtrReg);
+void addUninitializedSymbol(SymbolTable &symbolTable, shared_ptr<IdC> symbol);
 void handleReturn(shared_ptr<RetTypeNameC> retType);
-void handleReturnExp(shared_ptr<RetTypeNameC> retType, shared_ptr<STypeC> rawExp);
-void emitReturn(shared_ptr<RetTypeNameC> retType, shared_ptr<ExpC> exp);
+void handleReturnExp(shared_ptr<RetTypeNameC> retType, const ExpC &exp);
+// exp is nullptr for a void return
+void emitReturn(shared_ptr<RetTypeNameC> retType, const ExpC *exp);
 
 #endif
\ No newline at end of file
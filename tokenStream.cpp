@@ -0,0 +1,80 @@
+#include "tokenStream.hpp"
+
+#include <memory>
+
+#include "hw3_output.hpp"
+#include "stats.hpp"
+#include "tokens.hpp"
+#include "trace.hpp"
+
+typedef yy::parser::token token;
+
+TokenStream::TokenStream(SourceFile &source) : tokens(), nextToken(0), lexError() {
+    std::unique_ptr<void, void (*)(void *)> scanner(scanSource(source.getBuffer(), source.getBufferSize()), endScan);
+    yy::parser::semantic_type value;
+
+    for (;;) {
+        Token current = {token::YYEOF, 0, -1, std::string_view()};
+
+        try {
+            current.kind = scanToken(&value, scanner.get());
+        } catch (const CompileError &e) {
+            this->lexError = e.what();
+            current.kind = LEX_ERROR;
+        }
+        current.lineno = yylineno;
+
+        switch (current.kind) {
+            case token::ID:
+                current.id = value.as<SymbolId>();
+                value.destroy<SymbolId>();
+                break;
+            case token::NUM:
+            case token::STRING:
+                current.text = value.as<std::string_view>();
+                value.destroy<std::string_view>();
+                break;
+        }
+
+        size_t capacity = this->tokens.capacity();
+        this->tokens.push_back(current);
+        countGrowth(Subsystem::TOKENS, this->tokens, capacity);
+        if (current.kind == token::YYEOF or current.kind == LEX_ERROR) {
+            break;
+        }
+    }
+}
+
+std::vector<Token> &TokenStream::getTokens() {
+    return this->tokens;
+}
+
+int TokenStream::lex(yy::parser::semantic_type *yylval, yy::parser::location_type *yylloc) {
+    const Token &current = this->tokens[this->nextToken];
+    *yylloc = this->nextToken;
+    if (activeTrace) {
+        activeTrace->tokenHandedOut(this->nextToken);
+    }
+    // The last token is EOF or an error, and is given again if asked for again
+    if (this->nextToken + 1 < this->tokens.size()) {
+        this->nextToken++;
+    }
+
+    yylineno = current.lineno;
+    switch (current.kind) {
+        case LEX_ERROR:
+            throw CompileError(this->lexError);
+        case token::ID:
+            yylval->emplace<SymbolId>(current.id);
+            break;
+        case token::NUM:
+        case token::STRING:
+            yylval->emplace<std::string_view>(current.text);
+            break;
+    }
+    return current.kind;
+}
+
+int yylex(yy::parser::semantic_type *yylval, yy::parser::location_type *yylloc, TokenStream &tokens) {
+    return tokens.lex(yylval, yylloc);
+}
@@ -0,0 +1,45 @@
+#ifndef TOKEN_STREAM_H_
+#define TOKEN_STREAM_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "interner.hpp"
+#include "io.hpp"
+#include "parser.tab.hpp"
+
+struct Token {
+    // A yy::parser::token kind, or LEX_ERROR
+    int kind;
+    // yylineno right after the token was scanned
+    int lineno;
+    // The symbol of an ID
+    SymbolId id;
+    // The text of a NUM or STRING
+    std::string_view text;
+};
+
+// The whole token stream of a source, scanned before parsing so it can be looked at (and edited) as a whole.
+// The parser reads it back through yylex exactly as if it were scanning
+class TokenStream {
+   private:
+    std::vector<Token> tokens;
+    size_t nextToken;
+    std::string lexError;
+
+   public:
+    // Kind of the token standing in for a lexical error. The error is raised when the parser reaches it, so errors
+    // earlier in the source are still reported first
+    static const int LEX_ERROR = -1;
+
+    // Scan all of source, which must outlive the stream
+    explicit TokenStream(SourceFile &source);
+    TokenStream(const TokenStream &) = delete;
+    void operator=(const TokenStream &) = delete;
+    std::vector<Token> &getTokens();
+    // Give the parser the next token and its index, and publish its line in yylineno
+    int lex(yy::parser::semantic_type *yylval, yy::parser::location_type *yylloc);
+};
+
+#endif
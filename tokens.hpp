@@ -1,13 +1,12 @@
 #ifndef TOKENS_HPP_
 #define TOKENS_HPP_
 #include <stdlib.h>
-  extern int yylineno;
-  extern char* yytext;
-// Check if MacOS
-#ifdef __APPLE__
-  extern size_t yyleng;
-#else
-  extern int yyleng;
-#endif
-  extern int yylex();
+
+#include <cstddef>
+  // Line of the last token scanned on this thread. Each scanner keeps its own line count and publishes it here
+  extern thread_local int yylineno;
+  // Start a reentrant scanner reading tokens directly out of buffer, which must end with the two flex end-of-buffer
+  // markers and outlive the scanner
+  void *scanSource(char *buffer, size_t size);
+  void endScan(void *scanner);
 #endif /* TOKENS_HPP_ */
@@ -0,0 +1,123 @@
+#include "trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "io.hpp"
+#include "stats.hpp"
+
+using std::string;
+
+typedef std::chrono::steady_clock Clock;
+
+thread_local TraceRecorder *activeTrace = nullptr;
+
+static const Clock::time_point traceEpoch = Clock::now();
+// The events of all the compilations that ended so far, comma separated
+static std::mutex traceMutex;
+static string traceEvents;
+// Trace thread ids are handed out in the order threads first publish
+static std::atomic<int> nextThreadId(1);
+static thread_local int traceThreadId = 0;
+
+TraceRecorder::TraceRecorder() : events(), tokenTimes(), openSpans(0) {}
+
+double TraceRecorder::now() {
+    return std::chrono::duration<double, std::micro>(Clock::now() - traceEpoch).count();
+}
+
+void TraceRecorder::begin(const string &name, const char *category) {
+    this->events.push_back({'B', name, category, now(), 0, ""});
+    this->openSpans++;
+}
+
+void TraceRecorder::end(const string &args) {
+    this->events.push_back({'E', "", "", now(), 0, args});
+    this->openSpans--;
+}
+
+void TraceRecorder::complete(const string &name, const char *category, double start, const string &args) {
+    this->events.push_back({'X', name, category, start, now() - start, args});
+}
+
+void TraceRecorder::counter(const char *name, const string &args) {
+    this->events.push_back({'C', name, "", now(), 0, args});
+}
+
+void TraceRecorder::tokenHandedOut(size_t token) {
+    if (token >= this->tokenTimes.size()) {
+        this->tokenTimes.resize(token + 1, now());
+    }
+}
+
+void TraceRecorder::expression(size_t firstToken) {
+    if (firstToken < this->tokenTimes.size() and this->tokenTimes.size() - firstToken >= LARGE_EXPRESSION_TOKENS) {
+        this->complete("expression", "expression", this->tokenTimes[firstToken],
+                       "\"tokens\": " + std::to_string(this->tokenTimes.size() - firstToken));
+    }
+}
+
+void TraceRecorder::publish() {
+    // Spans cut short by a compile error end with the compilation
+    while (this->openSpans > 0) {
+        this->end();
+    }
+
+    if (traceThreadId == 0) {
+        traceThreadId = nextThreadId++;
+    }
+
+    string json;
+    char header[128];
+    for (auto &event : this->events) {
+        snprintf(header, sizeof(header), "{\"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d", event.phase,
+                 event.timestamp, traceThreadId);
+        json += json.empty() ? "" : ",\n";
+        json += header;
+        if (event.phase == 'X') {
+            snprintf(header, sizeof(header), ", \"dur\": %.3f", event.duration);
+            json += header;
+        }
+        if (not event.name.empty()) {
+            json += ", \"name\": " + quoteJson(event.name);
+        }
+        if (event.category[0]) {
+            json += ", \"cat\": \"" + string(event.category) + "\"";
+        }
+        if (not event.args.empty()) {
+            json += ", \"args\": {" + event.args + "}";
+        }
+        json += "}";
+    }
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (not json.empty()) {
+        traceEvents += traceEvents.empty() ? "" : ",\n";
+        traceEvents += json;
+    }
+}
+
+TraceCollection::TraceCollection(const string &sourceName)
+    : recorder(), start(TraceRecorder::now()), sourceName(sourceName) {
+    activeTrace = &this->recorder;
+}
+
+TraceCollection::~TraceCollection() {
+    this->recorder.complete("compile " + this->sourceName, "compile", this->start);
+    activeTrace = nullptr;
+    this->recorder.publish();
+}
+
+bool writeTrace(const char *path) {
+    OutputWriter out;
+    if (not out.open(path)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    out.write("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    out.write(traceEvents);
+    out.write("\n]}\n");
+    return out.flush();
+}
@@ -0,0 +1,88 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Timeline of compilations in the Chrome trace-event format, for chrome://tracing or Perfetto. Each compilation
+// records its own events while it runs, and they are added to the process' trace when it ends. Every hook checks
+// activeTrace first, so tracing costs nothing but that check when it is off
+class TraceRecorder {
+    struct Event {
+        // 'B'egin, 'E'nd, 'X' (complete) or 'C'ounter
+        char phase;
+        std::string name;
+        const char *category;
+        // Microseconds since the process started tracing
+        double timestamp;
+        double duration;
+        // Members of the event's args object, e.g. "\"lines\": 12"
+        std::string args;
+    };
+
+    std::vector<Event> events;
+    // When each token was handed to the parser, so spans can start at the first token of a symbol
+    std::vector<double> tokenTimes;
+    int openSpans;
+
+   public:
+    // Expressions spanning fewer tokens than this aren't traced
+    static const size_t LARGE_EXPRESSION_TOKENS = 32;
+
+    TraceRecorder();
+    static double now();
+    void begin(const std::string &name, const char *category);
+    void end(const std::string &args = "");
+    void complete(const std::string &name, const char *category, double start, const std::string &args = "");
+    void counter(const char *name, const std::string &args);
+    void tokenHandedOut(size_t token);
+    // Trace the expression starting at token, if it is large
+    void expression(size_t firstToken);
+    // Add the events to the process' trace, as run by the calling thread
+    void publish();
+};
+
+// The recorder of the calling thread's compilation, or null if it isn't traced
+extern thread_local TraceRecorder *activeTrace;
+
+// Traces the calling thread's compilation of sourceName for its lifetime
+class TraceCollection {
+    TraceRecorder recorder;
+    double start;
+    std::string sourceName;
+
+   public:
+    explicit TraceCollection(const std::string &sourceName);
+    TraceCollection(const TraceCollection &) = delete;
+    void operator=(const TraceCollection &) = delete;
+    ~TraceCollection();
+};
+
+// A span for the lifetime of the scope, if tracing
+class TraceSpan {
+    const char *name;
+    double start;
+
+   public:
+    explicit TraceSpan(const char *name) : name(name), start(activeTrace ? TraceRecorder::now() : 0) {}
+    TraceSpan(const TraceSpan &) = delete;
+    void operator=(const TraceSpan &) = delete;
+    ~TraceSpan() {
+        if (activeTrace) {
+            activeTrace->complete(this->name, this->name, this->start);
+        }
+    }
+};
+
+// Trace the expression starting at firstToken, if it is large and tracing
+inline void traceExpression(size_t firstToken) {
+    if (activeTrace) {
+        activeTrace->expression(firstToken);
+    }
+}
+
+// Write the process' trace to path. Returns false (with errno set) on failure
+bool writeTrace(const char *path);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TYPES_H_
+#define TYPES_H_
+
+#include <string>
+#include <vector>
+
+// FanC types. BAD_VIRTUAL_CALL is the type of a function symbol, whose real type is its return type
+enum class TypeName : unsigned char {
+    INT,
+    BYTE,
+    BOOL,
+    STRING,
+    VOID,
+    BAD_VIRTUAL_CALL,
+};
+
+struct TypeInfo {
+    const char *name;
+    const char *llvmType;
+    // Size in bytes of a value of the type
+    int size;
+    bool isSigned;
+    bool isNumeric;
+    bool isValue;
+    bool isRetType;
+};
+
+// Indexed by TypeName
+constexpr TypeInfo typeInfos[] = {
+    {"INT", "i32", 4, true, true, true, true},
+    {"BYTE", "i8", 1, false, true, true, true},
+    {"BOOL", "i1", 1, false, false, true, true},
+    {"STRING", "i8*", 8, false, false, true, false},
+    {"VOID", "void", 0, false, false, false, true},
+    {"BAD_VIRTUAL_CALL", "", 0, false, false, true, true},
+};
+
+// implicitCasts[dst][src] is true if a src value may be used where a dst is expected
+constexpr bool implicitCasts[][6] = {
+    /* INT */ {true, true, false, false, false, false},
+    /* BYTE */ {false, true, false, false, false, false},
+    /* BOOL */ {false, false, true, false, false, false},
+    /* STRING */ {false, false, false, true, false, false},
+    /* VOID */ {false, false, false, false, true, false},
+    /* BAD_VIRTUAL_CALL */ {false, false, false, false, false, true},
+};
+
+constexpr const TypeInfo &getTypeInfo(TypeName type) {
+    return typeInfos[static_cast<int>(type)];
+}
+
+constexpr bool areTypesCompatible(TypeName dstType, TypeName srcType) {
+    return implicitCasts[static_cast<int>(dstType)][static_cast<int>(srcType)];
+}
+
+inline std::string typeNameToString(TypeName type) {
+    return getTypeInfo(type).name;
+}
+
+inline std::string typeNameToLlvmType(TypeName type) {
+    return getTypeInfo(type).llvmType;
+}
+
+// For the course's output functions, which take type names as strings
+inline std::vector<std::string> typeNamesToStrings(const std::vector<TypeName> &types) {
+    std::vector<std::string> names;
+
+    for (auto type : types) {
+        names.push_back(typeNameToString(type));
+    }
+
+    return names;
+}
+
+#endif